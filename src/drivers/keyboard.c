@@ -0,0 +1,75 @@
+#include "keyboard.h"
+#include "keys.h"
+#include "ring_buffer.h"
+#include "kernel/cpu.h"
+#include "kernel/irq.h"
+#include "kernel/intstat.h"
+#include "kernel/softirq.h"
+#include "kernel/pic.h" /* inb */
+#include "kernel/tty.h"
+
+/* scancodes from the IRQ handler to keyboard_work() */
+static struct ring_buffer scancodes = make_ring_buffer(uint8_t);
+static struct softirq work;
+
+/* decodes with interrupts enabled */
+static void keyboard_work(void*)
+{
+    static bool shift;
+    static bool alt;
+    static bool extended;
+
+    while (true) {
+        uint8_t key;
+        const uint32_t flags = interrupts_save();
+        const bool got = ring_buffer_get(&scancodes, &key);
+        interrupts_restore(flags);
+        if (!got) {
+            break;
+        }
+
+        if (key == KEY_EXTENDED) {
+            extended = true;
+            continue;
+        }
+        const bool released = key & KEY_RELEASED;
+        key &= ~KEY_RELEASED;
+
+        if (!extended && (key == KEY_RIGHT_SHIFT || key == KEY_LEFT_SHIFT)) {
+            shift = !released;
+        }
+        /* KEY_E_RIGHT_ALT has the same code after the prefix */
+        if (key == KEY_LEFT_ALT) {
+            alt = !released;
+        }
+        if (!extended && alt && !released && key >= KEY_F1 && key < KEY_F1 + TERMINAL_CONSOLES) {
+            terminal_switch(key - KEY_F1);
+        }
+        if (!extended && alt && !released && key == KEY_I) {
+            intstat_dump();
+        }
+        if (extended && shift && !released) {
+            if (key == KEY_E_PAGE_UP) {
+                terminal_scrollback(VGA_HEIGHT / 2);
+            } else if (key == KEY_E_PAGE_DOWN) {
+                terminal_scrollback(-(int)(VGA_HEIGHT / 2));
+            }
+        }
+        extended = false;
+    }
+}
+
+/* only reads the controller, reading acknowledges the byte */
+static void keyboard_irq(void*)
+{
+    const uint8_t key = inb(PIC_KEYBOARD);
+    /* dropped if keyboard_work() is 1024 keys behind */
+    ring_buffer_push(&scancodes, &key);
+    softirq_raise(&work);
+}
+
+int keyboard_init(void)
+{
+    work = SOFTIRQ_INIT(keyboard_work, NULL);
+    return irq_register(IRQ_KEYBOARD_CONTROLLER, keyboard_irq, NULL);
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+/*
+ * PS/2 keyboard
+ * =============
+ * Scancode set 1 from the controller at PIC_KEYBOARD, on IRQ 1. The IRQ
+ * handler only reads the scancode, a softirq decodes it. Keys the console
+ * handles itself:
+ *
+ *   Shift+PageUp/PageDown   scrollback, see terminal_scrollback()
+ *   Alt+F1 to Alt+F4        virtual consoles, see terminal_switch()
+ *   Alt+I                   interrupt statistics, see intstat_dump()
+ */
+
+/* Registers the IRQ handler, returns -1 if that fails */
+int keyboard_init(void);
@@ -0,0 +1,38 @@
+#include "pit.h"
+#include "kernel/pic.h" /* outb, inb */
+
+uint32_t pit_divisor(uint32_t hz)
+{
+    const uint32_t divisor = (PIT_FREQUENCY + hz / 2) / hz;
+    return divisor < 0x10000 ? divisor : 0x10000;
+}
+
+void pit_set_periodic(uint32_t hz)
+{
+    /* 65536 is written as 0 */
+    const uint32_t divisor = pit_divisor(hz);
+
+    outb(PIT_COMMAND, PIT_SELECT_CHANNEL_0 | PIT_ACCESS_LOHI | PIT_MODE_RATE);
+    outb(PIT_CHANNEL_0, divisor & 0xff);
+    outb(PIT_CHANNEL_0, (divisor >> 8) & 0xff);
+}
+
+void pit_set_oneshot(uint16_t count)
+{
+    outb(PIT_COMMAND, PIT_SELECT_CHANNEL_0 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+    outb(PIT_CHANNEL_0, count & 0xff);
+    outb(PIT_CHANNEL_0, count >> 8);
+}
+
+void pit_countdown_start(uint16_t count)
+{
+    outb(PIT_GATE, (inb(PIT_GATE) & ~PIT_SPEAKER) | PIT_GATE_2);
+    outb(PIT_COMMAND, PIT_SELECT_CHANNEL_2 | PIT_ACCESS_LOHI | PIT_MODE_ONESHOT);
+    outb(PIT_CHANNEL_2, count & 0xff);
+    outb(PIT_CHANNEL_2, count >> 8);
+}
+
+bool pit_countdown_done(void)
+{
+    return inb(PIT_GATE) & PIT_OUTPUT_2;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Programmable interval timer
+ * ===========================
+ * Channel 0 of the 8253/8254, wired to IRQ 0. It divides PIT_FREQUENCY by
+ * a 16-bit reload value, 0 standing for 65536, so the slowest rate is about
+ * 18.2 Hz.
+ *
+ * Channel 2 normally drives the PC speaker. Its gate and output are also
+ * readable through PIT_GATE, which makes it a timer that can be polled
+ * without an interrupt, used to calibrate the TSC (see clock.h).
+ *
+ * https://wiki.osdev.org/Programmable_Interval_Timer
+ */
+constexpr uint32_t PIT_FREQUENCY = 1193182;
+
+enum pit_port : uint16_t {
+    PIT_CHANNEL_0 = 0x40,
+    PIT_CHANNEL_2 = 0x42,
+    PIT_COMMAND   = 0x43,
+    PIT_GATE      = 0x61,
+};
+
+enum pit_gate_bits : uint8_t {
+    PIT_GATE_2    = 1<<0, /* channel 2 counts while set */
+    PIT_SPEAKER   = 1<<1,
+    PIT_OUTPUT_2  = 1<<5, /* read only */
+};
+
+enum pit_command : uint8_t {
+    PIT_SELECT_CHANNEL_0 = 0b00<<6,
+    PIT_SELECT_CHANNEL_2 = 0b10<<6,
+    PIT_ACCESS_LOHI      = 0b11<<4, /* reload value low byte, then high */
+    PIT_MODE_ONESHOT     = 0b000<<1, /* output goes high at the end of the count */
+    PIT_MODE_RATE        = 0b010<<1, /* periodic, one pulse per period */
+};
+
+/* PIT counts per period at `hz`, at most 65536 */
+uint32_t pit_divisor(uint32_t hz);
+
+/* Raises IRQ 0 `hz` times a second, as close as the divisor allows */
+void pit_set_periodic(uint32_t hz);
+
+/* Raises IRQ 0 once, `count` PIT counts from now, and not again until
+ * channel 0 is programmed anew */
+void pit_set_oneshot(uint16_t count);
+
+/* Starts channel 2 counting down from `count` with the speaker off */
+void pit_countdown_start(uint16_t count);
+
+/* true once the count of pit_countdown_start() has run out */
+bool pit_countdown_done(void);
@@ -0,0 +1,254 @@
+#include "serial.h"
+#include "kernel/cpu.h" /* interrupts_save */
+#include "kernel/irq.h"
+#include "kernel/pic.h" /* outb, inb */
+
+static struct {
+    bool    registered;    /* serial_irq() is on IRQ 4 */
+    bool    interrupts;
+    bool    tx_busy;       /* THR empty interrupt on, serial_irq() refills */
+    uint8_t modem_control;
+
+    /* bytes ever queued and taken, only the low bits index the rings */
+    size_t  tx_head;
+    size_t  tx_tail;
+    size_t  rx_head;
+    size_t  rx_tail;
+    uint8_t tx[SERIAL_TX_SIZE];
+    uint8_t rx[SERIAL_RX_SIZE];
+} com1;
+
+_Static_assert((SERIAL_TX_SIZE & (SERIAL_TX_SIZE - 1)) == 0);
+_Static_assert((SERIAL_RX_SIZE & (SERIAL_RX_SIZE - 1)) == 0);
+
+static inline uint8_t in(enum serial_register reg)
+{
+    return inb(SERIAL_COM1 + reg);
+}
+
+static inline void out(enum serial_register reg, uint8_t value)
+{
+    outb(SERIAL_COM1 + reg, value);
+}
+
+/* the counters change in serial_irq() */
+static inline size_t load(const size_t* p)
+{
+    return __atomic_load_n(p, __ATOMIC_RELAXED);
+}
+
+static inline void wait_thr_empty(void)
+{
+    while (!(in(SERIAL_LINE_STATUS) & SERIAL_LSR_THR_EMPTY)) {
+        /* wait for the transmitter */
+    }
+}
+
+/*
+ * Transmit ring
+ * =============
+ * Only touched with interrupts off or from the IRQ handler.
+ */
+
+/* Moves up to a FIFO worth of queued bytes to the transmitter, the THR
+ * (and with it the FIFO) must be empty */
+static void tx_fill(void)
+{
+    for (size_t n = 0; n < SERIAL_FIFO_SIZE && com1.tx_tail != com1.tx_head; n++) {
+        out(SERIAL_DATA, com1.tx[com1.tx_tail++ & (SERIAL_TX_SIZE - 1)]);
+    }
+}
+
+static void tx_drain_polled(void)
+{
+    while (com1.tx_tail != com1.tx_head) {
+        wait_thr_empty();
+        tx_fill();
+    }
+}
+
+static void tx_queue(uint8_t byte)
+{
+    if (com1.tx_head - com1.tx_tail == SERIAL_TX_SIZE) {
+        /* full, make room the slow way */
+        wait_thr_empty();
+        tx_fill();
+    }
+    com1.tx[com1.tx_head++ & (SERIAL_TX_SIZE - 1)] = byte;
+}
+
+/* Starts the transmitter if the IRQ handler isn't already feeding it */
+static void tx_kick(void)
+{
+    if (com1.tx_busy) {
+        return;
+    }
+    if (in(SERIAL_LINE_STATUS) & SERIAL_LSR_THR_EMPTY) {
+        tx_fill();
+    }
+    com1.tx_busy = true;
+    out(SERIAL_INTERRUPT_ENABLE, SERIAL_IER_RX_READY | SERIAL_IER_THR_EMPTY);
+}
+
+/*
+ * IRQ 4
+ * =====
+ */
+static void serial_irq(void*)
+{
+    uint8_t id;
+    while (!((id = in(SERIAL_INTERRUPT_ID)) & SERIAL_IIR_NONE)) {
+        switch (id & SERIAL_IIR_ID_MASK) {
+        case SERIAL_IIR_THR_EMPTY:
+            if (com1.tx_tail == com1.tx_head) {
+                com1.tx_busy = false;
+                out(SERIAL_INTERRUPT_ENABLE, SERIAL_IER_RX_READY);
+            } else {
+                tx_fill();
+            }
+            break;
+
+        case SERIAL_IIR_RX_READY:
+        case SERIAL_IIR_RX_TIMEOUT:
+            while (in(SERIAL_LINE_STATUS) & SERIAL_LSR_DATA_READY) {
+                const uint8_t c = in(SERIAL_DATA);
+                /* dropped if nobody reads */
+                if (com1.rx_head - com1.rx_tail < SERIAL_RX_SIZE) {
+                    com1.rx[com1.rx_head++ & (SERIAL_RX_SIZE - 1)] = c;
+                }
+            }
+            break;
+
+        case SERIAL_IIR_LINE_STATUS:
+            in(SERIAL_LINE_STATUS);
+            break;
+
+        case SERIAL_IIR_MODEM_STATUS:
+            in(SERIAL_MODEM_STATUS);
+            break;
+        }
+    }
+}
+
+/*
+ * Interface
+ * =========
+ */
+void serial_init(void)
+{
+    const uint32_t flags = interrupts_save();
+    tx_drain_polled();
+    com1.interrupts = false;
+    com1.tx_busy = false;
+
+    out(SERIAL_INTERRUPT_ENABLE, 0);
+
+    /* divisor 1: 115200 / 1 baud */
+    out(SERIAL_LINE_CONTROL, SERIAL_LCR_DLAB);
+    out(SERIAL_DATA, 1);
+    out(SERIAL_INTERRUPT_ENABLE, 0);
+    out(SERIAL_LINE_CONTROL, SERIAL_LCR_8N1);
+
+    out(SERIAL_FIFO_CONTROL, SERIAL_FCR_ENABLE
+                           | SERIAL_FCR_CLEAR_RX
+                           | SERIAL_FCR_CLEAR_TX
+                           | SERIAL_FCR_TRIGGER_14);
+    com1.modem_control = SERIAL_MCR_DTR | SERIAL_MCR_RTS;
+    out(SERIAL_MODEM_CONTROL, com1.modem_control);
+    interrupts_restore(flags);
+}
+
+int serial_start_interrupts(void)
+{
+    if (!com1.registered) {
+        if (irq_register(IRQ_SERIAL_COM1, serial_irq, NULL) < 0) {
+            return -1;
+        }
+        com1.registered = true;
+    }
+
+    const uint32_t flags = interrupts_save();
+    com1.interrupts = true;
+    com1.modem_control |= SERIAL_MCR_OUT2;
+    out(SERIAL_MODEM_CONTROL, com1.modem_control);
+    out(SERIAL_INTERRUPT_ENABLE, SERIAL_IER_RX_READY | (com1.tx_busy ? SERIAL_IER_THR_EMPTY : 0));
+    interrupts_restore(flags);
+    return 0;
+}
+
+void serial_loopback(bool on)
+{
+    serial_flush();
+    if (on) {
+        com1.modem_control |= SERIAL_MCR_LOOP;
+    } else {
+        com1.modem_control &= ~SERIAL_MCR_LOOP;
+    }
+    out(SERIAL_MODEM_CONTROL, com1.modem_control);
+}
+
+void serial_putchar(char c)
+{
+    serial_write((struct str){.data = &c, .len = 1});
+}
+
+void serial_write(struct str s)
+{
+    if (!com1.interrupts) {
+        for (size_t i = 0; i < s.len; i++) {
+            if (s.data[i] == '\n') {
+                wait_thr_empty();
+                out(SERIAL_DATA, '\r');
+            }
+            wait_thr_empty();
+            out(SERIAL_DATA, s.data[i]);
+        }
+        return;
+    }
+
+    const uint32_t flags = interrupts_save();
+    for (size_t i = 0; i < s.len; i++) {
+        if (s.data[i] == '\n') {
+            tx_queue('\r');
+        }
+        tx_queue(s.data[i]);
+    }
+    tx_kick();
+    interrupts_restore(flags);
+}
+
+void serial_flush(void)
+{
+    uint32_t flags = interrupts_save();
+    if (!(flags & EFLAGS_INTERRUPT)) {
+        /* serial_irq() can't run */
+        tx_drain_polled();
+    }
+    interrupts_restore(flags);
+
+    while (load(&com1.tx_tail) != load(&com1.tx_head)) {
+        __asm__ volatile ("pause");
+    }
+    while (!(in(SERIAL_LINE_STATUS) & SERIAL_LSR_TX_EMPTY)) {
+        /* wait for the last byte to be shifted out */
+    }
+}
+
+bool serial_getchar(char* c)
+{
+    if (!com1.interrupts) {
+        if (!(in(SERIAL_LINE_STATUS) & SERIAL_LSR_DATA_READY)) {
+            return false;
+        }
+        *c = in(SERIAL_DATA);
+        return true;
+    }
+
+    const uint32_t flags = interrupts_save();
+    const bool ready = com1.rx_tail != com1.rx_head;
+    if (ready) {
+        *c = com1.rx[com1.rx_tail++ & (SERIAL_RX_SIZE - 1)];
+    }
+    interrupts_restore(flags);
+    return ready;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "str.h"
+
+/*
+ * 16550 UART
+ * ==========
+ * COM1 at 115200 baud 8N1 with the 16 byte FIFOs enabled. It starts out
+ * polled, every byte waits for the transmitter. That is what the in-kernel
+ * benchmarks and panics want.
+ *
+ * serial_start_interrupts() switches to interrupt driven operation. Output
+ * is queued in a ring of SERIAL_TX_SIZE bytes, and whenever the transmitter
+ * runs empty the IRQ handler refills the FIFO with up to SERIAL_FIFO_SIZE
+ * bytes at once. Writers only wait if the ring is full, and then they drain
+ * it themselves. Received bytes are queued for serial_getchar().
+ */
+constexpr size_t SERIAL_FIFO_SIZE = 16;
+constexpr size_t SERIAL_TX_SIZE = 4096; /* a power of two */
+constexpr size_t SERIAL_RX_SIZE = 256;  /* a power of two */
+
+enum serial_port : uint16_t {
+    SERIAL_COM1 = 0x3F8,
+};
+
+/* register offsets from the port base */
+enum serial_register : uint16_t {
+    SERIAL_DATA             = 0, /* DLAB=1: divisor latch low  */
+    SERIAL_INTERRUPT_ENABLE = 1, /* DLAB=1: divisor latch high */
+    SERIAL_INTERRUPT_ID     = 2, /* read */
+    SERIAL_FIFO_CONTROL     = 2, /* write */
+    SERIAL_LINE_CONTROL     = 3,
+    SERIAL_MODEM_CONTROL    = 4,
+    SERIAL_LINE_STATUS      = 5,
+    SERIAL_MODEM_STATUS     = 6,
+};
+
+enum serial_interrupt_enable : uint8_t {
+    SERIAL_IER_RX_READY  = 1<<0,
+    SERIAL_IER_THR_EMPTY = 1<<1,
+};
+
+enum serial_interrupt_id : uint8_t {
+    SERIAL_IIR_NONE         = 1<<0, /* no interrupt pending */
+    SERIAL_IIR_ID_MASK      = 0b111<<1,
+    SERIAL_IIR_LINE_STATUS  = 0b011<<1,
+    SERIAL_IIR_RX_READY     = 0b010<<1,
+    SERIAL_IIR_RX_TIMEOUT   = 0b110<<1,
+    SERIAL_IIR_THR_EMPTY    = 0b001<<1,
+    SERIAL_IIR_MODEM_STATUS = 0b000<<1,
+};
+
+enum serial_line_control : uint8_t {
+    SERIAL_LCR_8N1  = 0b11,
+    SERIAL_LCR_DLAB = 1<<7,
+};
+
+enum serial_fifo_control : uint8_t {
+    SERIAL_FCR_ENABLE      = 1<<0,
+    SERIAL_FCR_CLEAR_RX    = 1<<1,
+    SERIAL_FCR_CLEAR_TX    = 1<<2,
+    SERIAL_FCR_TRIGGER_14  = 0b11<<6,
+};
+
+enum serial_modem_control : uint8_t {
+    SERIAL_MCR_DTR  = 1<<0,
+    SERIAL_MCR_RTS  = 1<<1,
+    SERIAL_MCR_OUT2 = 1<<3, /* connects the interrupt line on PCs */
+    SERIAL_MCR_LOOP = 1<<4, /* output goes straight back to the input */
+};
+
+enum serial_line_status : uint8_t {
+    SERIAL_LSR_DATA_READY  = 1<<0,
+    SERIAL_LSR_THR_EMPTY   = 1<<5,
+    SERIAL_LSR_TX_EMPTY    = 1<<6, /* FIFO and shift register empty */
+};
+
+/* 115200 baud 8N1 with FIFOs enabled, interrupts off. Output still queued
+ * from interrupt driven operation is sent first */
+void serial_init(void);
+
+/* Switches to interrupt driven operation, returns -1 if the IRQ handler
+ * can't be registered */
+int serial_start_interrupts(void);
+
+/* Loops the output back to the input, so nothing leaves the machine */
+void serial_loopback(bool on);
+
+/* Translates '\n' to "\r\n" */
+void serial_putchar(char c);
+
+void serial_write(struct str s);
+
+/* Waits until everything queued has been sent */
+void serial_flush(void);
+
+/* Returns false if nothing has been received */
+bool serial_getchar(char* c);
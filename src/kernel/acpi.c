@@ -0,0 +1,198 @@
+#include "acpi.h"
+#include "libc.h"
+
+struct __attribute__((packed)) acpi_rsdp {
+    char     signature[8]; /* "RSD PTR " */
+    uint8_t  checksum;     /* of the first 20 bytes */
+    char     oem_id[6];
+    uint8_t  revision;
+    uint32_t rsdt_address;
+};
+
+struct __attribute__((packed)) acpi_sdt_header {
+    char     signature[4];
+    uint32_t length;       /* including the header */
+    uint8_t  revision;
+    uint8_t  checksum;     /* of `length` bytes */
+    char     oem_id[6];
+    char     oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+};
+_Static_assert(sizeof(struct acpi_sdt_header) == 36);
+
+struct __attribute__((packed)) acpi_madt {
+    struct acpi_sdt_header header;
+    uint32_t lapic_address;
+    uint32_t flags;
+    uint8_t  entries[];    /* { type, length, ... } */
+};
+
+enum acpi_madt_flags : uint32_t {
+    ACPI_MADT_PCAT_COMPAT = 1<<0,
+};
+
+enum acpi_madt_entry_type : uint8_t {
+    ACPI_MADT_LAPIC          = 0,
+    ACPI_MADT_IOAPIC         = 1,
+    ACPI_MADT_OVERRIDE       = 2,
+    ACPI_MADT_LAPIC_ADDRESS  = 5,
+};
+
+struct __attribute__((packed)) acpi_madt_lapic {
+    uint8_t  type, length;
+    uint8_t  processor_id;
+    uint8_t  apic_id;
+    uint32_t flags;        /* bit 0: enabled */
+};
+
+struct __attribute__((packed)) acpi_madt_ioapic {
+    uint8_t  type, length;
+    uint8_t  id;
+    uint8_t  reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+};
+
+struct __attribute__((packed)) acpi_madt_override {
+    uint8_t  type, length;
+    uint8_t  bus;          /* 0: ISA */
+    uint8_t  source;       /* ISA IRQ */
+    uint32_t gsi;
+    uint16_t flags;
+};
+
+struct __attribute__((packed)) acpi_madt_lapic_address {
+    uint8_t  type, length;
+    uint16_t reserved;
+    uint64_t address;
+};
+
+static bool checksum_ok(const void* p, size_t n)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += ((const uint8_t*)p)[i];
+    }
+    return sum == 0;
+}
+
+/* the RSDP is on a 16 byte boundary in one of two places */
+static const struct acpi_rsdp* rsdp_scan(uint32_t begin, uint32_t end)
+{
+    for (uint32_t addr = begin; addr + sizeof(struct acpi_rsdp) <= end; addr += 16) {
+        const struct acpi_rsdp* rsdp = (const struct acpi_rsdp*)addr;
+        if (memcmp(rsdp->signature, "RSD PTR ", 8) == 0
+         && checksum_ok(rsdp, sizeof *rsdp))
+        {
+            return rsdp;
+        }
+    }
+    return NULL;
+}
+
+static const struct acpi_rsdp* rsdp_find(void)
+{
+    /* the first KiB of the EBDA, whose segment is stored at 0x40E */
+    const uint32_t ebda = (uint32_t)*(const uint16_t*)0x40E << 4;
+    const struct acpi_rsdp* rsdp = NULL;
+    if (ebda != 0) {
+        rsdp = rsdp_scan(ebda, ebda + 1024);
+    }
+    if (rsdp == NULL) {
+        rsdp = rsdp_scan(0xE0000, 0x100000);
+    }
+    return rsdp;
+}
+
+static const struct acpi_madt* madt_find(void)
+{
+    const struct acpi_rsdp* rsdp = rsdp_find();
+    if (rsdp == NULL) {
+        return NULL;
+    }
+
+    const struct acpi_sdt_header* rsdt = (const struct acpi_sdt_header*)rsdp->rsdt_address;
+    if (memcmp(rsdt->signature, "RSDT", 4) != 0 || !checksum_ok(rsdt, rsdt->length)) {
+        return NULL;
+    }
+
+    const uint32_t* tables = (const uint32_t*)(rsdt + 1);
+    const size_t count = (rsdt->length - sizeof *rsdt) / sizeof *tables;
+    for (size_t i = 0; i < count; i++) {
+        const struct acpi_sdt_header* h = (const struct acpi_sdt_header*)tables[i];
+        if (memcmp(h->signature, "APIC", 4) == 0 && checksum_ok(h, h->length)) {
+            return (const struct acpi_madt*)h;
+        }
+    }
+    return NULL;
+}
+
+bool acpi_madt_parse(struct acpi_madt_info* out)
+{
+    const struct acpi_madt* madt = madt_find();
+    if (madt == NULL) {
+        return false;
+    }
+
+    *out = (struct acpi_madt_info){
+        .lapic_address = madt->lapic_address,
+        .pcat_compat = madt->flags & ACPI_MADT_PCAT_COMPAT,
+    };
+    /* identity mapped unless overridden */
+    for (size_t irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        out->isa[irq] = (struct acpi_isa_irq){.gsi = irq};
+    }
+
+    const uint8_t* p = madt->entries;
+    const uint8_t* end = (const uint8_t*)madt + madt->header.length;
+    while (p + 2 <= end && p[1] >= 2 && p + p[1] <= end) {
+        switch (p[0]) {
+        case ACPI_MADT_LAPIC: {
+            const struct acpi_madt_lapic* e = (const void*)p;
+            if ((e->flags & 1) && out->cpu_count < CPU_MAX) {
+                out->cpu_apic_ids[out->cpu_count++] = e->apic_id;
+            }
+            break;
+        }
+        case ACPI_MADT_IOAPIC: {
+            const struct acpi_madt_ioapic* e = (const void*)p;
+            if (out->ioapic_count < ACPI_IOAPICS_MAX) {
+                out->ioapics[out->ioapic_count++] = (struct acpi_ioapic){
+                    .id = e->id,
+                    .address = e->address,
+                    .gsi_base = e->gsi_base,
+                };
+            }
+            break;
+        }
+        case ACPI_MADT_OVERRIDE: {
+            const struct acpi_madt_override* e = (const void*)p;
+            if (e->bus == 0 && e->source < ACPI_ISA_IRQS) {
+                out->isa[e->source] = (struct acpi_isa_irq){.gsi = e->gsi, .flags = e->flags};
+            }
+            break;
+        }
+        case ACPI_MADT_LAPIC_ADDRESS: {
+            const struct acpi_madt_lapic_address* e = (const void*)p;
+            if (e->address < 0x100000000ULL) {
+                out->lapic_address = e->address;
+            }
+            break;
+        }
+        }
+        p += p[1];
+    }
+
+    /* an override takes the pin from the IRQ identity mapped to it */
+    for (size_t irq = 0; irq < ACPI_ISA_IRQS; irq++) {
+        for (size_t other = 0; other < ACPI_ISA_IRQS; other++) {
+            if (other != irq && out->isa[other].gsi == irq && out->isa[irq].gsi == irq) {
+                out->isa[irq].gsi = ACPI_GSI_NONE;
+            }
+        }
+    }
+
+    return out->ioapic_count > 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h" /* CPU_MAX */
+
+/*
+ * ACPI tables
+ * ===========
+ * Only as much as the interrupt controllers need. acpi_madt_parse() finds
+ * the RSDP in the BIOS areas, follows the RSDT to the MADT (signature
+ * "APIC") and collects the local APICs, the IO-APICs and how the 16 ISA IRQs
+ * are wired to them. It reads physical memory directly, so it runs before
+ * paging like fbcon_init().
+ *
+ * https://uefi.org/specs/ACPI/6.5/05_ACPI_Software_Programming_Model.html#multiple-apic-description-table-madt
+ */
+constexpr size_t ACPI_IOAPICS_MAX = 4;
+constexpr size_t ACPI_ISA_IRQS = 16;
+
+/* MPS INTI flags of an interrupt source override, the bus default for ISA
+ * is edge triggered and active high */
+enum acpi_inti_flags : uint16_t {
+    ACPI_INTI_POLARITY_MASK    = 0b11,
+    ACPI_INTI_ACTIVE_HIGH      = 0b01,
+    ACPI_INTI_ACTIVE_LOW       = 0b11,
+    ACPI_INTI_TRIGGER_MASK     = 0b11<<2,
+    ACPI_INTI_EDGE             = 0b01<<2,
+    ACPI_INTI_LEVEL            = 0b11<<2,
+};
+
+struct acpi_ioapic {
+    uint8_t  id;
+    uint32_t address;  /* physical */
+    uint32_t gsi_base; /* global system interrupt of pin 0 */
+};
+
+/* an ISA IRQ whose pin another IRQ took over, e.g. IRQ 2 when IRQ 0 is
+ * moved to pin 2 */
+constexpr uint32_t ACPI_GSI_NONE = UINT32_MAX;
+
+struct acpi_isa_irq {
+    uint32_t gsi;      /* or ACPI_GSI_NONE */
+    uint16_t flags;    /* enum acpi_inti_flags */
+};
+
+struct acpi_madt_info {
+    uint32_t            lapic_address;  /* physical */
+    bool                pcat_compat;    /* there are 8259 PICs too */
+
+    size_t              cpu_count;      /* enabled ones, at most CPU_MAX */
+    uint8_t             cpu_apic_ids[CPU_MAX];
+
+    size_t              ioapic_count;
+    struct acpi_ioapic  ioapics[ACPI_IOAPICS_MAX];
+
+    struct acpi_isa_irq isa[ACPI_ISA_IRQS];
+};
+
+/* Returns false if there is no valid RSDP, RSDT or MADT, or the MADT lists
+ * no IO-APIC */
+bool acpi_madt_parse(struct acpi_madt_info* out);
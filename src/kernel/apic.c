@@ -0,0 +1,190 @@
+#include "apic.h"
+#include "acpi.h"
+#include "page.h"
+
+/* byte offsets of the 32-bit local APIC registers, each on its own 16
+ * bytes */
+enum lapic_register : uint32_t {
+    LAPIC_ID        = 0x20,  /* bits 24-31 */
+    LAPIC_TPR       = 0x80,  /* task priority, classes at or below are held */
+    LAPIC_EOI       = 0xB0,
+    LAPIC_SVR       = 0xF0,  /* spurious vector and software enable */
+    LAPIC_LVT_LINT0 = 0x350,
+    LAPIC_LVT_LINT1 = 0x360,
+};
+
+enum lapic_bits : uint32_t {
+    LAPIC_SVR_ENABLE = 1<<8,
+    LAPIC_LVT_NMI    = 0b100<<8,
+    LAPIC_LVT_MASKED = 1<<16,
+};
+
+/* the IO-APIC has an index register and a data window */
+enum ioapic_port : uint32_t {
+    IOAPIC_REGSEL = 0x00,
+    IOAPIC_WINDOW = 0x10,
+};
+
+enum ioapic_register : uint32_t {
+    IOAPIC_VERSION     = 0x01, /* bits 16-23: pins - 1 */
+    IOAPIC_REDIRECTION = 0x10, /* two registers per pin, low then high */
+};
+
+/* low half of a redirection entry, the high half holds the destination
+ * APIC ID in bits 24-31 */
+enum ioapic_redirection : uint32_t {
+    IOAPIC_VECTOR_MASK = 0xFF,
+    IOAPIC_ACTIVE_LOW  = 1<<13,
+    IOAPIC_LEVEL       = 1<<15,
+    IOAPIC_MASKED      = 1<<16,
+};
+
+struct ioapic_pin {
+    uintptr_t ioapic;        /* register base, 0 if the line isn't wired */
+    uint8_t   pin;
+    uint32_t  low;           /* last written low half */
+};
+
+static struct acpi_madt_info madt;
+static bool active;
+static uintptr_t lapic;
+static struct ioapic_pin lines[ACPI_ISA_IRQS];
+
+static inline uint32_t lapic_read(enum lapic_register reg)
+{
+    return *(volatile uint32_t*)(lapic + reg);
+}
+
+static inline void lapic_write(enum lapic_register reg, uint32_t value)
+{
+    *(volatile uint32_t*)(lapic + reg) = value;
+}
+
+static uint32_t ioapic_read(uintptr_t ioapic, uint32_t reg)
+{
+    *(volatile uint32_t*)(ioapic + IOAPIC_REGSEL) = reg;
+    return *(volatile uint32_t*)(ioapic + IOAPIC_WINDOW);
+}
+
+static void ioapic_write(uintptr_t ioapic, uint32_t reg, uint32_t value)
+{
+    *(volatile uint32_t*)(ioapic + IOAPIC_REGSEL) = reg;
+    *(volatile uint32_t*)(ioapic + IOAPIC_WINDOW) = value;
+}
+
+static size_t ioapic_pins(uintptr_t ioapic)
+{
+    return ((ioapic_read(ioapic, IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+}
+
+bool apic_init(void)
+{
+    if (!acpi_madt_parse(&madt)) {
+        return false;
+    }
+    lapic = madt.lapic_address;
+
+    for (size_t i = 0; i < madt.ioapic_count; i++) {
+        const uintptr_t ioapic = madt.ioapics[i].address;
+        const size_t pins = ioapic_pins(ioapic);
+        for (size_t pin = 0; pin < pins; pin++) {
+            ioapic_write(ioapic, IOAPIC_REDIRECTION + 2 * pin, IOAPIC_MASKED);
+        }
+
+        for (size_t line = 0; line < ACPI_ISA_IRQS; line++) {
+            const struct acpi_isa_irq* isa = &madt.isa[line];
+            if (isa->gsi < madt.ioapics[i].gsi_base
+             || isa->gsi >= madt.ioapics[i].gsi_base + pins)
+            {
+                continue;
+            }
+            uint32_t low = IOAPIC_MASKED;
+            if ((isa->flags & ACPI_INTI_POLARITY_MASK) == ACPI_INTI_ACTIVE_LOW) {
+                low |= IOAPIC_ACTIVE_LOW;
+            }
+            if ((isa->flags & ACPI_INTI_TRIGGER_MASK) == ACPI_INTI_LEVEL) {
+                low |= IOAPIC_LEVEL;
+            }
+            lines[line] = (struct ioapic_pin){
+                .ioapic = ioapic,
+                .pin = isa->gsi - madt.ioapics[i].gsi_base,
+                .low = low,
+            };
+        }
+    }
+
+    /* a MADT without enabled processors, at least we are running */
+    if (madt.cpu_count == 0) {
+        madt.cpu_apic_ids[0] = lapic_read(LAPIC_ID) >> 24;
+        madt.cpu_count = 1;
+    }
+
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_NMI);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+
+    active = true;
+    return true;
+}
+
+bool apic_active(void)
+{
+    return active;
+}
+
+static void map_4mb(uint32_t* page_directory, uint32_t addr)
+{
+    addr &= ~0x3fffffU;
+    page_directory[addr >> 22] = addr | PDE_4MB | PDE_DISABLE_CACHE | PDE_WRITE | PDE_PRESENT;
+}
+
+void apic_map(uint32_t* page_directory)
+{
+    if (!active) {
+        return;
+    }
+
+    map_4mb(page_directory, lapic);
+    for (size_t i = 0; i < madt.ioapic_count; i++) {
+        map_4mb(page_directory, madt.ioapics[i].address);
+    }
+}
+
+size_t apic_cpu_count(void)
+{
+    return madt.cpu_count;
+}
+
+void apic_eoi(void)
+{
+    lapic_write(LAPIC_EOI, 0);
+}
+
+int ioapic_route(size_t line, uint8_t vector, size_t cpu)
+{
+    if (line >= ACPI_ISA_IRQS || lines[line].ioapic == 0 || cpu >= madt.cpu_count) {
+        return -1;
+    }
+
+    struct ioapic_pin* p = &lines[line];
+    const uint32_t reg = IOAPIC_REDIRECTION + 2 * p->pin;
+    p->low = (p->low & ~IOAPIC_VECTOR_MASK) | vector;
+
+    /* masked while the halves disagree */
+    ioapic_write(p->ioapic, reg, p->low | IOAPIC_MASKED);
+    ioapic_write(p->ioapic, reg + 1, (uint32_t)madt.cpu_apic_ids[cpu] << 24);
+    ioapic_write(p->ioapic, reg, p->low);
+    return 0;
+}
+
+void ioapic_mask(size_t line, bool masked)
+{
+    if (line >= ACPI_ISA_IRQS || lines[line].ioapic == 0) {
+        return;
+    }
+
+    struct ioapic_pin* p = &lines[line];
+    p->low = masked ? p->low | IOAPIC_MASKED : p->low & ~IOAPIC_MASKED;
+    ioapic_write(p->ioapic, IOAPIC_REDIRECTION + 2 * p->pin, p->low);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Local APIC and IO-APIC
+ * ======================
+ * The replacement for the 8259 PICs when the MADT describes an IO-APIC
+ * (see acpi.h), which is the case on anything newer than a 486 and on
+ * QEMU's default machine. Both are programmed through memory mapped
+ * registers, so an EOI is a single store to the local APIC instead of one
+ * or two port writes, and masking a line doesn't read back a PIC register.
+ *
+ * The IO-APIC routes each ISA IRQ, after the MADT's overrides (IRQ 0 is
+ * usually pin 2), to a vector on one CPU. The local APIC delivers the
+ * highest pending vector first, vector / 16 is its priority class.
+ *
+ * The legacy PICs stay remapped but masked, and LINT0 where they used to
+ * come in is masked too. irq.h decides which controller is used.
+ *
+ * https://wiki.osdev.org/APIC
+ * https://wiki.osdev.org/IOAPIC
+ */
+
+/* raised by the local APIC when an interrupt goes away before it is taken,
+ * needs no EOI */
+constexpr uint8_t APIC_SPURIOUS_VECTOR = 0xFF;
+
+/* Parses the MADT, enables the local APIC and masks every IO-APIC pin.
+ * Returns false and touches nothing if there is no IO-APIC. Called before
+ * paging */
+bool apic_init(void);
+
+bool apic_active(void);
+
+/* Identity maps the APIC registers with uncached 4 MiB pages, needs
+ * CR4_PSE */
+void apic_map(uint32_t* page_directory);
+
+/* number of CPUs in the MADT, valid targets of ioapic_route() */
+size_t apic_cpu_count(void);
+
+void apic_eoi(void);
+
+/* Delivers ISA IRQ `line` as `vector` to CPU `cpu`, the mask stays as it
+ * is. Returns -1 if the line isn't wired to an IO-APIC or there is no such
+ * CPU */
+int ioapic_route(size_t line, uint8_t vector, size_t cpu);
+
+void ioapic_mask(size_t line, bool masked);
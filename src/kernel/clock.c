@@ -0,0 +1,71 @@
+#include "clock.h"
+#include "cpu.h"
+#include "drivers/pit.h"
+
+static uint64_t base;   /* TSC at clock_init() */
+static uint32_t mult;
+static uint32_t shift;
+static uint32_t tsc_khz;
+
+/* PIT counts in one calibration round */
+static constexpr uint32_t CALIBRATE_COUNT = PIT_FREQUENCY * CLOCK_CALIBRATE_MS / 1000;
+_Static_assert(CALIBRATE_COUNT <= 0xffff);
+
+/* (a * mul) >> bits for bits <= 32, the 96-bit product never exists */
+static inline uint64_t mul_u64_u32_shr(uint64_t a, uint32_t mul, uint32_t bits)
+{
+    const uint32_t hi = a >> 32;
+    const uint32_t lo = a;
+    uint64_t ret = ((uint64_t)lo * mul) >> bits;
+    if (hi != 0) {
+        ret += ((uint64_t)hi * mul) << (32 - bits);
+    }
+    return ret;
+}
+
+static uint64_t calibrate_round(void)
+{
+    pit_countdown_start(CALIBRATE_COUNT);
+    const uint64_t begin = rdtsc();
+    while (!pit_countdown_done()) {
+    }
+    return rdtsc() - begin;
+}
+
+void clock_init(void)
+{
+    uint64_t cycles = UINT64_MAX;
+    for (size_t i = 0; i < CLOCK_CALIBRATE_ROUNDS; i++) {
+        const uint64_t c = calibrate_round();
+        cycles = c < cycles ? c : cycles;
+    }
+
+    /* the only divisions, once at boot */
+    const uint64_t tsc_hz = cycles * PIT_FREQUENCY / CALIBRATE_COUNT;
+    tsc_khz = tsc_hz / 1000;
+
+    /* ns per cycle as a 32.32 fixed point number, then as many fraction
+     * bits as still fit in 32 bits */
+    shift = 32;
+    while (shift > 0 && (1000000000ULL << shift) / tsc_hz > UINT32_MAX) {
+        shift--;
+    }
+    mult = (1000000000ULL << shift) / tsc_hz;
+
+    base = rdtsc();
+}
+
+uint32_t clock_tsc_khz(void)
+{
+    return tsc_khz;
+}
+
+uint64_t clock_cycles_to_ns(uint64_t cycles)
+{
+    return mul_u64_u32_shr(cycles, mult, shift);
+}
+
+uint64_t clock_monotonic_ns(void)
+{
+    return mul_u64_u32_shr(rdtsc() - base, mult, shift);
+}
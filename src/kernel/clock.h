@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * TSC clocksource
+ * ===============
+ * clock_init() counts TSC cycles over CLOCK_CALIBRATE_MS milliseconds of
+ * PIT channel 2 countdown, CLOCK_CALIBRATE_ROUNDS times, and keeps the
+ * smallest count (an SMI or a host preemption only ever adds cycles).
+ *
+ * Cycles are converted to nanoseconds as (cycles * mult) >> shift with a
+ * 32-bit `mult`, picked once so that it has as many significant bits as
+ * fit. The product is built from two 32x32 bit multiplies, so a conversion
+ * never divides and never overflows for any 64-bit cycle count.
+ *
+ * The TSC is assumed to tick at a constant rate, true for QEMU and for
+ * CPUs with an invariant TSC.
+ */
+constexpr uint32_t CLOCK_CALIBRATE_MS = 10;
+constexpr size_t CLOCK_CALIBRATE_ROUNDS = 3;
+
+/* Calibrates the TSC, takes about 30 ms. Call with interrupts disabled */
+void clock_init(void);
+
+/* 0 before clock_init() */
+uint32_t clock_tsc_khz(void);
+
+uint64_t clock_cycles_to_ns(uint64_t cycles);
+
+/* nanoseconds since clock_init(), from any context. Only a rdtsc and two
+ * multiplies, nothing is shared with interrupt handlers */
+uint64_t clock_monotonic_ns(void);
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Per-CPU helpers
+ * ===============
+ * Only the bootstrap processor runs kernel code for now, but per-CPU data is
+ * already laid out as arrays indexed by cpu_current() so that bringing up
+ * application processors does not change any data structures.
+ */
+constexpr size_t CPU_MAX = 4;
+
+static inline size_t cpu_current(void)
+{
+    return 0;
+}
+
+/* Read the time-stamp counter */
+static inline uint64_t rdtsc(void)
+{
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+struct cpuid_regs {
+    uint32_t eax, ebx, ecx, edx;
+};
+
+static inline struct cpuid_regs cpuid(uint32_t leaf)
+{
+    struct cpuid_regs r;
+    __asm__ volatile ("cpuid"
+                      : "=a"(r.eax), "=b"(r.ebx), "=c"(r.ecx), "=d"(r.edx)
+                      : "a"(leaf), "c"(0));
+    return r;
+}
+
+constexpr uint32_t CPUID_1_ECX_MONITOR = 1U<<3;    /* MONITOR and MWAIT */
+
+constexpr uint32_t EFLAGS_INTERRUPT = 1U<<9;
+
+/* Disables interrupts, returns the old eflags for interrupts_restore() */
+static inline uint32_t interrupts_save(void)
+{
+    uint32_t flags;
+    __asm__ volatile ("pushf\n\tpop %0\n\tcli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void interrupts_restore(uint32_t flags)
+{
+    if (flags & EFLAGS_INTERRUPT) {
+        __asm__ volatile ("sti" : : : "memory");
+    }
+}
+
+static inline bool interrupts_enabled(void)
+{
+    uint32_t flags;
+    __asm__ volatile ("pushf\n\tpop %0" : "=r"(flags));
+    return flags & EFLAGS_INTERRUPT;
+}
@@ -0,0 +1,209 @@
+#include "fbcon.h"
+#include "font.h"
+#include "page.h"
+#include "tty.h"
+
+static constexpr size_t FBCON_BYTES_PER_PIXEL = 4;
+
+static struct {
+    bool      active;
+    uint8_t*  fb;        /* physical, identity mapped */
+    size_t    pitch;
+    size_t    width;
+    size_t    height;
+    uint8_t*  lines;     /* first scanline of the text area */
+    size_t    left;      /* byte offset of the text area in a scanline */
+    uint32_t  palette[16];
+} fb;
+
+/* glyph cache, indexed by glyph_slot() of the cell it holds */
+static uint32_t cache_cell[FBCON_CACHE_SIZE];
+static uint32_t cache[FBCON_CACHE_SIZE][FBCON_GLYPH_HEIGHT][FBCON_GLYPH_WIDTH]
+    __attribute__((aligned(64)));
+
+_Static_assert(FBCON_GLYPH_HEIGHT == 2 * FONT_HEIGHT, "font rows are doubled");
+_Static_assert(FBCON_GLYPH_WIDTH == FONT_WIDTH);
+_Static_assert((FBCON_CACHE_SIZE & (FBCON_CACHE_SIZE - 1)) == 0);
+
+/* the standard VGA text mode palette */
+static const uint32_t vga_rgb[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+static inline uint32_t channel(uint32_t value, uint8_t position, uint8_t size)
+{
+    return (value >> (8 - size)) << position;
+}
+
+bool fbcon_init(uint32_t multiboot_magic, const struct multiboot_info* mbi)
+{
+    if (multiboot_magic != MULTIBOOT_BOOTLOADER_MAGIC
+     || !(mbi->flags & MULTIBOOT_INFO_FRAMEBUFFER)
+     || mbi->framebuffer_type != MULTIBOOT_FRAMEBUFFER_RGB
+     || mbi->framebuffer_bpp != FBCON_BYTES_PER_PIXEL * 8
+     || mbi->framebuffer_addr > UINT32_MAX - (uint64_t)mbi->framebuffer_pitch * mbi->framebuffer_height
+     || mbi->framebuffer_width < VGA_WIDTH * FBCON_GLYPH_WIDTH
+     || mbi->framebuffer_height < VGA_HEIGHT * FBCON_GLYPH_HEIGHT)
+    {
+        return false;
+    }
+
+    fb.fb = (uint8_t*)(uintptr_t)mbi->framebuffer_addr;
+    fb.pitch = mbi->framebuffer_pitch;
+    fb.width = mbi->framebuffer_width;
+    fb.height = mbi->framebuffer_height;
+
+    const size_t top = (fb.height - VGA_HEIGHT * FBCON_GLYPH_HEIGHT) / 2;
+    fb.lines = fb.fb + top * fb.pitch;
+    fb.left = (fb.width - VGA_WIDTH * FBCON_GLYPH_WIDTH) / 2 * FBCON_BYTES_PER_PIXEL;
+
+    for (size_t i = 0; i < 16; i++) {
+        const uint32_t rgb = vga_rgb[i];
+        fb.palette[i] = channel(rgb >> 16 & 0xff, mbi->framebuffer_red_field_position, mbi->framebuffer_red_mask_size)
+                      | channel(rgb >> 8 & 0xff, mbi->framebuffer_green_field_position, mbi->framebuffer_green_mask_size)
+                      | channel(rgb & 0xff, mbi->framebuffer_blue_field_position, mbi->framebuffer_blue_mask_size);
+    }
+
+    for (size_t i = 0; i < FBCON_CACHE_SIZE; i++) {
+        cache_cell[i] = UINT32_MAX;
+    }
+
+    uint32_t* p = (uint32_t*)fb.fb;
+    for (size_t i = 0; i < fb.pitch / FBCON_BYTES_PER_PIXEL * fb.height; i++) {
+        p[i] = fb.palette[VGA_COLOR_BLACK];
+    }
+
+    fb.active = true;
+    return true;
+}
+
+bool fbcon_active(void)
+{
+    return fb.active;
+}
+
+void fbcon_map(uint32_t* page_directory)
+{
+    if (!fb.active) {
+        return;
+    }
+
+    const uint32_t begin = (uintptr_t)fb.fb;
+    const uint32_t end = begin + fb.pitch * fb.height;
+    for (uint32_t addr = begin & ~0x3fffffU; addr < end; addr += 0x400000) {
+        page_directory[addr >> 22] = addr | PDE_4MB | PDE_WRITE | PDE_PRESENT;
+    }
+}
+
+/*
+ * Glyph cache
+ * ===========
+ */
+static inline size_t glyph_slot(uint16_t cell)
+{
+    /* characters of one color go to consecutive slots */
+    return ((cell & 0xff) + (cell >> 8) * 37) & (FBCON_CACHE_SIZE - 1);
+}
+
+static const uint32_t* glyph(uint16_t cell)
+{
+    const size_t slot = glyph_slot(cell);
+    if (cache_cell[slot] == cell) {
+        return &cache[slot][0][0];
+    }
+
+    const uint8_t ch = cell & 0xff;
+    const uint32_t fg = fb.palette[cell >> 8 & 0xf];
+    const uint32_t bg = fb.palette[cell >> 12];
+    const uint8_t* rows = ch < 128 ? font8x8[ch] : font8x8['?'];
+
+    for (size_t y = 0; y < FBCON_GLYPH_HEIGHT; y++) {
+        const uint8_t bits = rows[y / 2];
+        for (size_t x = 0; x < FBCON_GLYPH_WIDTH; x++) {
+            cache[slot][y][x] = bits & (0x80 >> x) ? fg : bg;
+        }
+    }
+    cache_cell[slot] = cell;
+    return &cache[slot][0][0];
+}
+
+/*
+ * Drawing
+ * =======
+ */
+static inline uint8_t* cell_address(size_t x, size_t y)
+{
+    return fb.lines + y * FBCON_GLYPH_HEIGHT * fb.pitch
+         + fb.left + x * FBCON_GLYPH_WIDTH * FBCON_BYTES_PER_PIXEL;
+}
+
+/* glyphs[i] goes to the cell at `line` + i, all of them still in the cache */
+static void draw_glyphs(uint8_t* line, const uint32_t* const* glyphs, size_t n)
+{
+    /* scanline by scanline so the framebuffer is written sequentially */
+    for (size_t row = 0; row < FBCON_GLYPH_HEIGHT; row++) {
+        uint32_t* dst = (uint32_t*)line;
+        for (size_t i = 0; i < n; i++) {
+            __builtin_memcpy(dst, glyphs[i] + row * FBCON_GLYPH_WIDTH,
+                             FBCON_GLYPH_WIDTH * FBCON_BYTES_PER_PIXEL);
+            dst += FBCON_GLYPH_WIDTH;
+        }
+        line += fb.pitch;
+    }
+}
+
+void fbcon_draw(size_t x, size_t y, const uint16_t* cells, size_t n)
+{
+    /* The glyphs of a run of cells are looked up before any is copied. A
+     * cell that needs a slot another cell of the run still points to would
+     * overwrite that glyph, so the run is drawn first and a new one starts.
+     * `run_slots` marks the slots of the current run with its number */
+    static uint32_t run_slots[FBCON_CACHE_SIZE];
+    static uint32_t run;
+
+    const uint32_t* glyphs[VGA_WIDTH];
+    size_t begin = 0;
+    run++;
+    for (size_t i = 0; i < n; i++) {
+        const size_t slot = glyph_slot(cells[i]);
+        if (run_slots[slot] == run && cache_cell[slot] != cells[i]) {
+            draw_glyphs(cell_address(x + begin, y), glyphs + begin, i - begin);
+            begin = i;
+            run++;
+        }
+        run_slots[slot] = run;
+        glyphs[i] = glyph(cells[i]);
+    }
+    draw_glyphs(cell_address(x + begin, y), glyphs + begin, n - begin);
+}
+
+void fbcon_scroll(size_t rows)
+{
+    if (rows == 0 || rows >= VGA_HEIGHT) {
+        return;
+    }
+
+    /* whole scanlines, the margins are black on both sides anyway */
+    uint32_t* dst = (uint32_t*)fb.lines;
+    const uint32_t* src = (const uint32_t*)(fb.lines + rows * FBCON_GLYPH_HEIGHT * fb.pitch);
+    const size_t words = (VGA_HEIGHT - rows) * FBCON_GLYPH_HEIGHT * fb.pitch / sizeof *dst;
+    for (size_t i = 0; i < words; i++) {
+        dst[i] = src[i];
+    }
+}
+
+void fbcon_cursor(size_t x, size_t y, uint16_t cell)
+{
+    fbcon_draw(x, y, &cell, 1);
+
+    const uint32_t fg = fb.palette[cell >> 8 & 0xf];
+    uint8_t* line = cell_address(x, y) + (FBCON_GLYPH_HEIGHT - 2) * fb.pitch;
+    for (size_t row = 0; row < 2; row++) {
+        uint32_t* dst = (uint32_t*)line;
+        for (size_t i = 0; i < FBCON_GLYPH_WIDTH; i++) {
+            dst[i] = fg;
+        }
+        line += fb.pitch;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "multiboot.h"
+
+/*
+ * Framebuffer console
+ * ===================
+ * Draws the terminal's VGA_WIDTH x VGA_HEIGHT text cells into a linear
+ * framebuffer when the bootloader set one up, see the video mode in boot.S.
+ * The text area is centered on the screen. Only 32 bits per pixel RGB
+ * framebuffers below 4 GiB are supported, anything else stays in VGA text
+ * mode.
+ *
+ * Glyphs come from the 8x8 font in font.h with every row doubled. The
+ * first time a character is drawn in a color it is expanded to pixels in a
+ * direct mapped glyph cache, drawing a cell after that copies 32 bytes per
+ * scanline.
+ */
+constexpr size_t FBCON_GLYPH_WIDTH = 8;
+constexpr size_t FBCON_GLYPH_HEIGHT = 16;
+constexpr size_t FBCON_CACHE_SIZE = 256; /* glyphs, a power of two */
+
+/* Returns true if the multiboot information describes a usable framebuffer,
+ * which is then cleared. Called before paging */
+bool fbcon_init(uint32_t multiboot_magic, const struct multiboot_info* mbi);
+
+bool fbcon_active(void);
+
+/* Identity maps the framebuffer with 4 MiB pages, needs CR4_PSE */
+void fbcon_map(uint32_t* page_directory);
+
+/* Draws n cells in VGA text format (character | color << 8) starting at
+ * column x of text row y */
+void fbcon_draw(size_t x, size_t y, const uint16_t* cells, size_t n);
+
+/* Moves the text area up by `rows` text rows, the rows at the bottom keep
+ * their old content */
+void fbcon_scroll(size_t rows);
+
+/* Draws cell with an underline cursor */
+void fbcon_cursor(size_t x, size_t y, uint16_t cell);
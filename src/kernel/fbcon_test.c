@@ -0,0 +1,161 @@
+#define _GNU_SOURCE /* MAP_32BIT */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <sys/mman.h>
+#include "fbcon.h"
+#include "font.h"
+#include "tty.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+/* exactly the text area, so it starts at the first pixel */
+static constexpr size_t WIDTH = VGA_WIDTH * FBCON_GLYPH_WIDTH;
+static constexpr size_t HEIGHT = VGA_HEIGHT * FBCON_GLYPH_HEIGHT;
+static uint32_t* pixels;
+
+static const uint32_t vga_rgb[16] = {
+    0x000000, 0x0000AA, 0x00AA00, 0x00AAAA, 0xAA0000, 0xAA00AA, 0xAA5500, 0xAAAAAA,
+    0x555555, 0x5555FF, 0x55FF55, 0x55FFFF, 0xFF5555, 0xFF55FF, 0xFFFF55, 0xFFFFFF,
+};
+
+static bool init(void)
+{
+    /* fbcon only takes framebuffers below 4 GiB */
+    pixels = mmap(NULL, WIDTH * HEIGHT * sizeof *pixels, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (pixels == MAP_FAILED) {
+        return false;
+    }
+    const struct multiboot_info mbi = {
+        .flags = MULTIBOOT_INFO_FRAMEBUFFER,
+        .framebuffer_addr = (uintptr_t)pixels,
+        .framebuffer_pitch = WIDTH * sizeof *pixels,
+        .framebuffer_width = WIDTH,
+        .framebuffer_height = HEIGHT,
+        .framebuffer_bpp = 32,
+        .framebuffer_type = MULTIBOOT_FRAMEBUFFER_RGB,
+        .framebuffer_red_field_position = 16,
+        .framebuffer_red_mask_size = 8,
+        .framebuffer_green_field_position = 8,
+        .framebuffer_green_mask_size = 8,
+        .framebuffer_blue_field_position = 0,
+        .framebuffer_blue_mask_size = 8,
+    };
+    return fbcon_init(MULTIBOOT_BOOTLOADER_MAGIC, &mbi);
+}
+
+/* number of pixels of the cell at x, y that don't show `cell` */
+static size_t wrong_pixels(size_t x, size_t y, uint16_t cell)
+{
+    const uint8_t* rows = font8x8[cell & 0x7f];
+    size_t wrong = 0;
+    for (size_t py = 0; py < FBCON_GLYPH_HEIGHT; py++) {
+        for (size_t px = 0; px < FBCON_GLYPH_WIDTH; px++) {
+            const bool set = rows[py / 2] & (0x80 >> px);
+            const uint32_t want = vga_rgb[set ? cell >> 8 & 0xf : cell >> 12];
+            const size_t i = (y * FBCON_GLYPH_HEIGHT + py) * WIDTH + x * FBCON_GLYPH_WIDTH + px;
+            wrong += pixels[i] != want;
+        }
+    }
+    return wrong;
+}
+
+static uint16_t cell(char ch, uint8_t color)
+{
+    return (uint8_t)ch | color << 8;
+}
+
+int main()
+{
+    if (!init()) {
+        printf("no framebuffer below 4 GiB\n");
+        return EXIT_FAILURE;
+    }
+
+    test_begin("cells sharing a glyph cache slot in one span");
+    do {
+        /* ' ' grey on blue and 'p' grey on black go to the same slot */
+        const uint16_t cells[] = {
+            cell(' ', 0x17), cell('p', 0x07), cell(' ', 0x17), cell('p', 0x07),
+            cell('a', 0x07), cell('p', 0x07), cell(' ', 0x17),
+        };
+        const size_t n = sizeof cells / sizeof *cells;
+        size_t errors = 0;
+        /* cold and then warm cache */
+        for (size_t round = 0; round < 2; round++) {
+            fbcon_draw(3, 5, cells, n);
+            for (size_t i = 0; i < n; i++) {
+                errors += wrong_pixels(3 + i, 5, cells[i]);
+            }
+        }
+        if (errors != 0) {
+            test_fail("%zu wrong pixels", errors);
+        } else {
+            test_ok("%zu cells", n);
+        }
+    } while (0);
+
+    test_begin("a full row of every color");
+    do {
+        uint16_t cells[VGA_WIDTH];
+        for (size_t i = 0; i < VGA_WIDTH; i++) {
+            cells[i] = cell('A' + i % 26, (uint8_t)(i * 7));
+        }
+        fbcon_draw(0, VGA_HEIGHT - 1, cells, VGA_WIDTH);
+        size_t errors = 0;
+        for (size_t i = 0; i < VGA_WIDTH; i++) {
+            errors += wrong_pixels(i, VGA_HEIGHT - 1, cells[i]);
+        }
+        if (errors != 0) {
+            test_fail("%zu wrong pixels", errors);
+        } else {
+            test_ok("%zu cells", (size_t)VGA_WIDTH);
+        }
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}
@@ -0,0 +1,99 @@
+#include "font.h"
+
+const uint8_t font8x8[128][FONT_HEIGHT] = {
+    [' ' ] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    ['!' ] = {0x18, 0x18, 0x18, 0x18, 0x18, 0x00, 0x18, 0x00},
+    ['"' ] = {0x6C, 0x6C, 0x48, 0x00, 0x00, 0x00, 0x00, 0x00},
+    ['#' ] = {0x6C, 0x6C, 0xFE, 0x6C, 0xFE, 0x6C, 0x6C, 0x00},
+    ['$' ] = {0x18, 0x7E, 0xD8, 0x7C, 0x1A, 0xFC, 0x18, 0x00},
+    ['%' ] = {0xC6, 0xCC, 0x18, 0x30, 0x60, 0xCC, 0x8C, 0x00},
+    ['&' ] = {0x38, 0x6C, 0x38, 0x76, 0xDC, 0xCC, 0x76, 0x00},
+    ['\''] = {0x18, 0x18, 0x30, 0x00, 0x00, 0x00, 0x00, 0x00},
+    ['(' ] = {0x0C, 0x18, 0x30, 0x30, 0x30, 0x18, 0x0C, 0x00},
+    [')' ] = {0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x18, 0x30, 0x00},
+    ['*' ] = {0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00},
+    ['+' ] = {0x00, 0x18, 0x18, 0x7E, 0x18, 0x18, 0x00, 0x00},
+    [',' ] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x30},
+    ['-' ] = {0x00, 0x00, 0x00, 0x7E, 0x00, 0x00, 0x00, 0x00},
+    ['.' ] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00},
+    ['/' ] = {0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0, 0x00},
+    ['0' ] = {0x7C, 0xC6, 0xCE, 0xDE, 0xF6, 0xE6, 0x7C, 0x00},
+    ['1' ] = {0x18, 0x38, 0x78, 0x18, 0x18, 0x18, 0x7E, 0x00},
+    ['2' ] = {0x7C, 0xC6, 0x06, 0x1C, 0x70, 0xC0, 0xFE, 0x00},
+    ['3' ] = {0x7C, 0xC6, 0x06, 0x3C, 0x06, 0xC6, 0x7C, 0x00},
+    ['4' ] = {0x0E, 0x1E, 0x36, 0x66, 0xFE, 0x06, 0x06, 0x00},
+    ['5' ] = {0xFE, 0xC0, 0xFC, 0x06, 0x06, 0xC6, 0x7C, 0x00},
+    ['6' ] = {0x3C, 0x60, 0xC0, 0xFC, 0xC6, 0xC6, 0x7C, 0x00},
+    ['7' ] = {0xFE, 0x06, 0x0C, 0x18, 0x30, 0x30, 0x30, 0x00},
+    ['8' ] = {0x7C, 0xC6, 0xC6, 0x7C, 0xC6, 0xC6, 0x7C, 0x00},
+    ['9' ] = {0x7C, 0xC6, 0xC6, 0x7E, 0x06, 0x0C, 0x78, 0x00},
+    [':' ] = {0x00, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x00},
+    [';' ] = {0x00, 0x18, 0x18, 0x00, 0x00, 0x18, 0x18, 0x30},
+    ['<' ] = {0x0C, 0x18, 0x30, 0x60, 0x30, 0x18, 0x0C, 0x00},
+    ['=' ] = {0x00, 0x00, 0x7E, 0x00, 0x7E, 0x00, 0x00, 0x00},
+    ['>' ] = {0x60, 0x30, 0x18, 0x0C, 0x18, 0x30, 0x60, 0x00},
+    ['?' ] = {0x7C, 0xC6, 0x06, 0x1C, 0x18, 0x00, 0x18, 0x00},
+    ['@' ] = {0x7C, 0xC6, 0xDE, 0xDE, 0xDE, 0xC0, 0x7C, 0x00},
+    ['A' ] = {0x38, 0x6C, 0xC6, 0xC6, 0xFE, 0xC6, 0xC6, 0x00},
+    ['B' ] = {0xFC, 0xC6, 0xC6, 0xFC, 0xC6, 0xC6, 0xFC, 0x00},
+    ['C' ] = {0x3C, 0x66, 0xC0, 0xC0, 0xC0, 0x66, 0x3C, 0x00},
+    ['D' ] = {0xF8, 0xCC, 0xC6, 0xC6, 0xC6, 0xCC, 0xF8, 0x00},
+    ['E' ] = {0xFE, 0xC0, 0xC0, 0xFC, 0xC0, 0xC0, 0xFE, 0x00},
+    ['F' ] = {0xFE, 0xC0, 0xC0, 0xFC, 0xC0, 0xC0, 0xC0, 0x00},
+    ['G' ] = {0x3C, 0x66, 0xC0, 0xDE, 0xC6, 0x66, 0x3E, 0x00},
+    ['H' ] = {0xC6, 0xC6, 0xC6, 0xFE, 0xC6, 0xC6, 0xC6, 0x00},
+    ['I' ] = {0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x7E, 0x00},
+    ['J' ] = {0x1E, 0x0C, 0x0C, 0x0C, 0xCC, 0xCC, 0x78, 0x00},
+    ['K' ] = {0xC6, 0xCC, 0xD8, 0xF0, 0xD8, 0xCC, 0xC6, 0x00},
+    ['L' ] = {0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xC0, 0xFE, 0x00},
+    ['M' ] = {0xC6, 0xEE, 0xFE, 0xD6, 0xC6, 0xC6, 0xC6, 0x00},
+    ['N' ] = {0xC6, 0xE6, 0xF6, 0xDE, 0xCE, 0xC6, 0xC6, 0x00},
+    ['O' ] = {0x7C, 0xC6, 0xC6, 0xC6, 0xC6, 0xC6, 0x7C, 0x00},
+    ['P' ] = {0xFC, 0xC6, 0xC6, 0xFC, 0xC0, 0xC0, 0xC0, 0x00},
+    ['Q' ] = {0x7C, 0xC6, 0xC6, 0xC6, 0xD6, 0xCC, 0x76, 0x00},
+    ['R' ] = {0xFC, 0xC6, 0xC6, 0xFC, 0xD8, 0xCC, 0xC6, 0x00},
+    ['S' ] = {0x7C, 0xC6, 0xC0, 0x7C, 0x06, 0xC6, 0x7C, 0x00},
+    ['T' ] = {0x7E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00},
+    ['U' ] = {0xC6, 0xC6, 0xC6, 0xC6, 0xC6, 0xC6, 0x7C, 0x00},
+    ['V' ] = {0xC6, 0xC6, 0xC6, 0xC6, 0x6C, 0x38, 0x10, 0x00},
+    ['W' ] = {0xC6, 0xC6, 0xC6, 0xD6, 0xFE, 0xEE, 0xC6, 0x00},
+    ['X' ] = {0xC6, 0x6C, 0x38, 0x38, 0x38, 0x6C, 0xC6, 0x00},
+    ['Y' ] = {0x66, 0x66, 0x66, 0x3C, 0x18, 0x18, 0x18, 0x00},
+    ['Z' ] = {0xFE, 0x0C, 0x18, 0x30, 0x60, 0xC0, 0xFE, 0x00},
+    ['[' ] = {0x3C, 0x30, 0x30, 0x30, 0x30, 0x30, 0x3C, 0x00},
+    ['\\'] = {0xC0, 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x00},
+    [']' ] = {0x3C, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x3C, 0x00},
+    ['^' ] = {0x10, 0x38, 0x6C, 0xC6, 0x00, 0x00, 0x00, 0x00},
+    ['_' ] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF},
+    ['`' ] = {0x30, 0x18, 0x0C, 0x00, 0x00, 0x00, 0x00, 0x00},
+    ['a' ] = {0x00, 0x00, 0x78, 0x0C, 0x7C, 0xCC, 0x76, 0x00},
+    ['b' ] = {0xC0, 0xC0, 0xF8, 0xCC, 0xCC, 0xCC, 0xF8, 0x00},
+    ['c' ] = {0x00, 0x00, 0x78, 0xCC, 0xC0, 0xCC, 0x78, 0x00},
+    ['d' ] = {0x0C, 0x0C, 0x7C, 0xCC, 0xCC, 0xCC, 0x7C, 0x00},
+    ['e' ] = {0x00, 0x00, 0x78, 0xCC, 0xFC, 0xC0, 0x78, 0x00},
+    ['f' ] = {0x38, 0x6C, 0x60, 0xF0, 0x60, 0x60, 0xF0, 0x00},
+    ['g' ] = {0x00, 0x00, 0x76, 0xCC, 0xCC, 0x7C, 0x0C, 0xF8},
+    ['h' ] = {0xC0, 0xC0, 0xD8, 0xEC, 0xCC, 0xCC, 0xCC, 0x00},
+    ['i' ] = {0x30, 0x00, 0x70, 0x30, 0x30, 0x30, 0x78, 0x00},
+    ['j' ] = {0x0C, 0x00, 0x1C, 0x0C, 0x0C, 0xCC, 0xCC, 0x78},
+    ['k' ] = {0xC0, 0xC0, 0xCC, 0xD8, 0xF0, 0xD8, 0xCC, 0x00},
+    ['l' ] = {0x70, 0x30, 0x30, 0x30, 0x30, 0x30, 0x78, 0x00},
+    ['m' ] = {0x00, 0x00, 0xCC, 0xFE, 0xFE, 0xD6, 0xC6, 0x00},
+    ['n' ] = {0x00, 0x00, 0xF8, 0xCC, 0xCC, 0xCC, 0xCC, 0x00},
+    ['o' ] = {0x00, 0x00, 0x78, 0xCC, 0xCC, 0xCC, 0x78, 0x00},
+    ['p' ] = {0x00, 0x00, 0xF8, 0xCC, 0xCC, 0xF8, 0xC0, 0xC0},
+    ['q' ] = {0x00, 0x00, 0x7C, 0xCC, 0xCC, 0x7C, 0x0C, 0x0C},
+    ['r' ] = {0x00, 0x00, 0xDC, 0xEC, 0xC0, 0xC0, 0xC0, 0x00},
+    ['s' ] = {0x00, 0x00, 0x7C, 0xC0, 0x78, 0x0C, 0xF8, 0x00},
+    ['t' ] = {0x30, 0x30, 0xFC, 0x30, 0x30, 0x36, 0x1C, 0x00},
+    ['u' ] = {0x00, 0x00, 0xCC, 0xCC, 0xCC, 0xCC, 0x76, 0x00},
+    ['v' ] = {0x00, 0x00, 0xCC, 0xCC, 0xCC, 0x78, 0x30, 0x00},
+    ['w' ] = {0x00, 0x00, 0xC6, 0xD6, 0xFE, 0xFE, 0x6C, 0x00},
+    ['x' ] = {0x00, 0x00, 0xC6, 0x6C, 0x38, 0x6C, 0xC6, 0x00},
+    ['y' ] = {0x00, 0x00, 0xCC, 0xCC, 0xCC, 0x7C, 0x0C, 0xF8},
+    ['z' ] = {0x00, 0x00, 0xFC, 0x18, 0x30, 0x60, 0xFC, 0x00},
+    ['{' ] = {0x0E, 0x18, 0x18, 0x70, 0x18, 0x18, 0x0E, 0x00},
+    ['|' ] = {0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00},
+    ['}' ] = {0x70, 0x18, 0x18, 0x0E, 0x18, 0x18, 0x70, 0x00},
+    ['~' ] = {0x76, 0xDC, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * 8x8 bitmap font for printable ASCII, one byte per row with the leftmost
+ * pixel in bit 7. Other characters are all zero.
+ */
+constexpr size_t FONT_WIDTH = 8;
+constexpr size_t FONT_HEIGHT = 8;
+
+extern const uint8_t font8x8[128][FONT_HEIGHT];
@@ -0,0 +1,77 @@
+#include "idle.h"
+#include "cpu.h"
+#include "clock.h"
+#include "timer.h"
+
+/* a cache line each, MONITOR watches `kicked` */
+struct idle_cpu {
+    volatile uint32_t kicked;
+    uint32_t          wakeups;
+    uint64_t          cycles;   /* halted */
+} __attribute__((aligned(64)));
+
+static struct idle_cpu cpus[CPU_MAX];
+static bool mwait;
+
+void idle_init(void)
+{
+    mwait = cpuid(1).ecx & CPUID_1_ECX_MONITOR;
+}
+
+bool idle_mwait(void)
+{
+    return mwait;
+}
+
+void idle_kick(size_t cpu)
+{
+    __atomic_store_n(&cpus[cpu].kicked, 1, __ATOMIC_RELEASE);
+}
+
+void idle_wait(void)
+{
+    struct idle_cpu* c = &cpus[cpu_current()];
+
+    __asm__ volatile ("cli" ::: "memory");
+    if (mwait) {
+        /* armed before the check, a kick in between still ends the mwait */
+        __asm__ volatile ("monitor" : : "a"(&c->kicked), "c"(0), "d"(0));
+    }
+    if (c->kicked) {
+        c->kicked = 0;
+        __asm__ volatile ("sti" ::: "memory");
+        return;
+    }
+
+    timer_idle_enter();
+    const uint64_t begin = rdtsc();
+    /* sti takes effect after the next instruction, an interrupt can't
+     * slip in before the wait starts */
+    if (mwait) {
+        /* C1, the shallowest state, hints beyond that are model specific */
+        __asm__ volatile ("sti\n\tmwait" : : "a"(0), "c"(0) : "memory");
+    } else {
+        __asm__ volatile ("sti\n\thlt" ::: "memory");
+    }
+    __asm__ volatile ("cli" ::: "memory");
+    c->cycles += rdtsc() - begin;
+    c->wakeups += 1;
+    /* the caller is about to look for work anyway */
+    c->kicked = 0;
+    timer_idle_exit();
+    __asm__ volatile ("sti" ::: "memory");
+}
+
+uint64_t idle_ns(size_t cpu)
+{
+    /* two loads on i686 */
+    const uint32_t flags = interrupts_save();
+    const uint64_t cycles = cpus[cpu].cycles;
+    interrupts_restore(flags);
+    return clock_cycles_to_ns(cycles);
+}
+
+uint32_t idle_wakeups(size_t cpu)
+{
+    return __atomic_load_n(&cpus[cpu].wakeups, __ATOMIC_RELAXED);
+}
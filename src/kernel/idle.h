@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Idle task
+ * =========
+ * The kernel main loop is the idle task: it runs whatever interrupt
+ * handlers left for it (klog records, queued terminal output) and then
+ * calls idle_wait() to halt until the next interrupt instead of spinning.
+ *
+ * A handler that leaves work behind calls idle_kick(). irq_dispatch() does
+ * it after every IRQ, so work queued between the loop's last check and the
+ * halt isn't left waiting for the next interrupt: idle_wait() re-checks the
+ * kick flag with interrupts disabled and returns right away if it is set.
+ *
+ * The CPU waits in MWAIT when CPUID reports MONITOR/MWAIT, HLT otherwise.
+ * MWAIT watches the cache line of the kick flag, so once other CPUs run a
+ * plain store to it wakes this one without an IPI. Interrupts end both.
+ *
+ * Time spent halted is counted per CPU with the TSC. It includes the
+ * interrupt handler that ended the halt, which is short next to the wait.
+ */
+
+/* Picks MWAIT or HLT, call once */
+void idle_init(void);
+
+/* true if idle_wait() uses MWAIT */
+bool idle_mwait(void);
+
+/* Marks work for `cpu`'s idle task, from any context */
+void idle_kick(size_t cpu);
+
+/* Halts the current CPU until an interrupt or idle_kick(), returns at once
+ * if it was kicked since the last call. Enables interrupts */
+void idle_wait(void);
+
+/* nanoseconds `cpu` spent halted, 0 before clock_init() */
+uint64_t idle_ns(size_t cpu);
+
+/* times `cpu` woke up from idle_wait() */
+uint32_t idle_wakeups(size_t cpu);
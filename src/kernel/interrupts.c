@@ -4,8 +4,12 @@
 #include "tty.h"
 #include "interrupts.h"
 #include "kernel_state.h"
+#include "klog.h"
 
 #include "pic.h"
+#include "irq.h"
+#include "softirq.h"
+#include "intstat.h"
 
 #define EXCEPTION_DEPTH_MAX 3
 
@@ -38,6 +42,7 @@ static void print_interrupt_frame(struct interrupt_frame* f)
 __attribute__((noreturn))
 static void panic_exception_not_implemented(struct interrupt_frame* frame, int exception_no, uint32_t err)
 {
+    terminal_emergency();
     terminal_set_color(VGA_COLOR_WHITE, VGA_COLOR_RED);
     printf(str_attach("non-implemented exception {i32} occurred\n"), exception_no);
 	struct str name = idt_desc_index_str[exception_no];
@@ -65,6 +70,7 @@ void exception_handler_general_protection_fault(struct interrupt_frame* frame, i
         panic(str_attach("fatal: too many nested exceptions\n"));
     }
     //terminal_clear();
+    terminal_emergency();
     terminal_set_color(VGA_COLOR_WHITE, VGA_COLOR_RED);
     printf(str_attach(
         "general protection fault by segment selector {str} :(\n"),
@@ -104,6 +110,7 @@ void exception_handler_page_fault(struct interrupt_frame* frame, int err)
     if (kernel.nested_exception_counter++ > EXCEPTION_DEPTH_MAX) {
         panic(str_attach("fatal: too many nested exceptions\n"));
     }
+    terminal_emergency();
     terminal_set_color(VGA_COLOR_WHITE, VGA_COLOR_RED);
     printf(str_attach(
         "page fault :(, err: 0x{x32}: ["),
@@ -164,13 +171,14 @@ void interrupt_default(struct interrupt_frame* frame)
 __attribute__((interrupt))
 void interrupt_handler_1(struct interrupt_frame* frame)
 {
+    const uint64_t begin = rdtsc();
     if (kernel.nested_exception_counter++ > EXCEPTION_DEPTH_MAX) {
         panic(str_attach("fatal: too many nested exceptions\n"));
     }
-    (void)frame;
-    printf(str_attach("interrupt_handler_1 called!\n"));
+    klog(str_attach("interrupt_handler_1 called from {x32}\n"), frame->ip);
 
     kernel.nested_exception_counter = 0;
+    intstat_record(IDT_DESC_INTERRUPT_SYSCALL, rdtsc() - begin);
 }
 
 /*
@@ -180,84 +188,48 @@ void interrupt_handler_1(struct interrupt_frame* frame)
 static void irq_stub(struct interrupt_frame* frame, int line)
 {
 	(void)frame;
-	(void)line;
     if (kernel.nested_exception_counter++ > EXCEPTION_DEPTH_MAX) {
         panic(str_attach("fatal: too many nested exceptions\n"));
     }
 
-    //printf(str_attach("irq handler {i32} called!\n"), line);
-	outb(PIC1_COMMAND, OCW2_EOI);
+    irq_dispatch(line);
     kernel.nested_exception_counter = 0;
-}
 
-__attribute__((interrupt)) void irq_handler_0(struct interrupt_frame* frame)  { irq_stub(frame, 0); }
+    /* the line is acknowledged, deferred work runs with interrupts on */
+    softirq_run(SOFTIRQ_IRQ_EXIT_MAX);
+}
 
-/* IRQ1 - keyboard controller */
-#include "keys.h"
+__attribute__((interrupt)) static void irq_handler_0(struct interrupt_frame* frame)  { irq_stub(frame, 0); }
+__attribute__((interrupt)) static void irq_handler_1(struct interrupt_frame* frame)  { irq_stub(frame, 1); }
+__attribute__((interrupt)) static void irq_handler_2(struct interrupt_frame* frame)  { irq_stub(frame, 2); }
+__attribute__((interrupt)) static void irq_handler_3(struct interrupt_frame* frame)  { irq_stub(frame, 3); }
+__attribute__((interrupt)) static void irq_handler_4(struct interrupt_frame* frame)  { irq_stub(frame, 4); }
+__attribute__((interrupt)) static void irq_handler_5(struct interrupt_frame* frame)  { irq_stub(frame, 5); }
+__attribute__((interrupt)) static void irq_handler_6(struct interrupt_frame* frame)  { irq_stub(frame, 6); }
+__attribute__((interrupt)) static void irq_handler_7(struct interrupt_frame* frame)  { irq_stub(frame, 7); }
+__attribute__((interrupt)) static void irq_handler_8(struct interrupt_frame* frame)  { irq_stub(frame, 8); }
+__attribute__((interrupt)) static void irq_handler_9(struct interrupt_frame* frame)  { irq_stub(frame, 9); }
+__attribute__((interrupt)) static void irq_handler_10(struct interrupt_frame* frame) { irq_stub(frame, 10); }
+__attribute__((interrupt)) static void irq_handler_11(struct interrupt_frame* frame) { irq_stub(frame, 11); }
+__attribute__((interrupt)) static void irq_handler_12(struct interrupt_frame* frame) { irq_stub(frame, 12); }
+__attribute__((interrupt)) static void irq_handler_13(struct interrupt_frame* frame) { irq_stub(frame, 13); }
+__attribute__((interrupt)) static void irq_handler_14(struct interrupt_frame* frame) { irq_stub(frame, 14); }
+__attribute__((interrupt)) static void irq_handler_15(struct interrupt_frame* frame) { irq_stub(frame, 15); }
+
+void* const irq_entries[IRQ_LINES] = {
+    irq_handler_0,  irq_handler_1,  irq_handler_2,  irq_handler_3,
+    irq_handler_4,  irq_handler_5,  irq_handler_6,  irq_handler_7,
+    irq_handler_8,  irq_handler_9,  irq_handler_10, irq_handler_11,
+    irq_handler_12, irq_handler_13, irq_handler_14, irq_handler_15,
+};
 
-__attribute__((interrupt))
-void irq_handler_1(struct interrupt_frame* frame) 
+/* nothing to do but count it, and no EOI */
+__attribute__((interrupt)) static void irq_spurious(struct interrupt_frame*)
 {
-	/* TODO: move keyboard logic to a separate compilation unit */
-	(void)frame;
-
-    for (struct kernel_hook* p = kernel.keypress_hooks;
-         p != NULL;
-         p = p->next)
-    {
-        // TODO
-        //proc_send(p->);
-    }
-
-#if 0
-	uint8_t key = inb(PIC_KEYBOARD);
-	bool released = key & KEY_RELEASED;
-	key &= ~KEY_RELEASED;
-
-	if (key == KEY_RIGHT_SHIFT || key == KEY_LEFT_SHIFT) {
-		shift = !released;
-        outb(PIC1_COMMAND, OCW2_EOI);
-        return;
-	}
-
-	if (key == KEY_E_RIGHT_CONTROL || key == KEY_LEFT_CONTROL) {
-		ctrl = !released;
-		(void)ctrl;
-        outb(PIC1_COMMAND, OCW2_EOI);
-        return;
-	}
-
-	if (!released) {
-		if (shift) {
-			key |= KEY_MODIFIER_SHIFT;
-		}
-		const char ch = ps2_key_char[key];
-		if (ch) {
-			terminal_putchar(ch);
-			kernel_input_buffer_push(ch);
-		} else {
-			printf(str_attach("[{str}]"), ps2_key_str[key]);
-		}
-	}
-#endif
-
-	outb(PIC1_COMMAND, OCW2_EOI);
+    intstat_record(APIC_SPURIOUS_VECTOR, 0);
 }
 
-__attribute__((interrupt)) void irq_handler_2(struct interrupt_frame* frame)  { irq_stub(frame, 2); }
-__attribute__((interrupt)) void irq_handler_3(struct interrupt_frame* frame)  { irq_stub(frame, 3); }
-__attribute__((interrupt)) void irq_handler_4(struct interrupt_frame* frame)  { irq_stub(frame, 4); }
-__attribute__((interrupt)) void irq_handler_5(struct interrupt_frame* frame)  { irq_stub(frame, 5); }
-__attribute__((interrupt)) void irq_handler_6(struct interrupt_frame* frame)  { irq_stub(frame, 6); }
-__attribute__((interrupt)) void irq_handler_7(struct interrupt_frame* frame)  { irq_stub(frame, 7); }
-__attribute__((interrupt)) void irq_handler_8(struct interrupt_frame* frame)  { irq_stub(frame, 8); }
-__attribute__((interrupt)) void irq_handler_9(struct interrupt_frame* frame)  { irq_stub(frame, 9); }
-__attribute__((interrupt)) void irq_handler_10(struct interrupt_frame* frame) { irq_stub(frame, 10); }
-__attribute__((interrupt)) void irq_handler_11(struct interrupt_frame* frame) { irq_stub(frame, 11); }
-__attribute__((interrupt)) void irq_handler_12(struct interrupt_frame* frame) { irq_stub(frame, 12); }
-__attribute__((interrupt)) void irq_handler_13(struct interrupt_frame* frame) { irq_stub(frame, 13); }
-__attribute__((interrupt)) void irq_handler_14(struct interrupt_frame* frame) { irq_stub(frame, 14); }
-__attribute__((interrupt)) void irq_handler_15(struct interrupt_frame* frame) { irq_stub(frame, 15); }
+void* const irq_spurious_entry = irq_spurious;
 
 
 /**
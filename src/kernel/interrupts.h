@@ -34,22 +34,12 @@ void interrupt_handler_1(struct interrupt_frame* frame);
  * IRQs
  * ====
  */
-__attribute__((interrupt)) void irq_handler_0(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_1(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_2(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_3(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_4(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_5(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_6(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_7(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_8(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_9(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_10(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_11(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_12(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_13(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_14(struct interrupt_frame*);
-__attribute__((interrupt)) void irq_handler_15(struct interrupt_frame*);
+/* entry points of IRQ 0 to 15, for IDT vectors irq_vector(line, priority)
+ * of every priority. They call irq_dispatch() */
+extern void* const irq_entries[];
+
+/* for APIC_SPURIOUS_VECTOR */
+extern void* const irq_spurious_entry;
 
 
 /*
@@ -0,0 +1,76 @@
+#include "intstat.h"
+#include "cpu.h"
+#include "irq.h"
+#include "kernel_state.h"
+#include "libc.h"
+#include "tty.h"
+#include "histogram.h"
+
+struct intstat_cpu {
+    struct histogram vectors[IDT_DESC_COUNT];
+};
+
+static struct intstat_cpu cpus[CPU_MAX];
+
+void intstat_record(size_t vector, uint64_t cycles)
+{
+    histogram_add(&cpus[cpu_current()].vectors[vector], cycles);
+}
+
+static void print_vector(size_t vector, const struct histogram* h)
+{
+    const size_t irqs = IDT_DESC_PIC1 + 16 * IRQ_PRIORITIES;
+    if (vector >= IDT_DESC_PIC1 && vector < irqs) {
+        const size_t v = vector - IDT_DESC_PIC1;
+        printf(str_attach("vector {u32} (IRQ {u32}, priority {u32}): "), vector, v % 16, v / 16);
+    } else if (vector == IDT_DESC_INTERRUPT_SYSCALL) {
+        printf(str_attach("vector {u32} (syscall): "), vector);
+    } else if (vector == APIC_SPURIOUS_VECTOR) {
+        printf(str_attach("vector {u32} (spurious): "), vector);
+    } else {
+        printf(str_attach("vector {u32}: "), vector);
+    }
+    printf(str_attach("{u64} taken, p50 {u64} p99 {u64} max {u64} cycles\n"),
+           h->count, histogram_quantile(h, 500), histogram_quantile(h, 990), h->max);
+
+    /* bucket b holds values below 2^b */
+    printf(str_attach("  cycles"));
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        if (h->buckets[b] == 0) {
+            continue;
+        }
+        if (b == HISTOGRAM_BUCKETS - 1) {
+            printf(str_attach(" >=2^{u32}:{u32}"), b - 1, h->buckets[b]);
+        } else {
+            printf(str_attach(" <2^{u32}:{u32}"), b, h->buckets[b]);
+        }
+    }
+    printf(str_attach("\n"));
+}
+
+void intstat_dump(void)
+{
+    const size_t console = terminal_select(TERMINAL_LOG_CONSOLE);
+
+    for (size_t cpu = 0; cpu < CPU_MAX; cpu++) {
+        bool header = false;
+        for (size_t vector = 0; vector < IDT_DESC_COUNT; vector++) {
+            /* a consistent copy, a handler on this CPU can't run halfway
+             * through it */
+            const uint32_t flags = interrupts_save();
+            const struct histogram h = cpus[cpu].vectors[vector];
+            interrupts_restore(flags);
+
+            if (h.count == 0) {
+                continue;
+            }
+            if (!header) {
+                printf(str_attach("[intstat] cpu {u32}\n"), cpu);
+                header = true;
+            }
+            print_vector(vector, &h);
+        }
+    }
+
+    terminal_select(console);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Interrupt statistics
+ * ====================
+ * Every IRQ, int 0x80 and the APIC spurious vector count the TSC cycles
+ * from handler entry to exit into a log2 histogram (histogram.h) of their
+ * vector, one set per CPU. For IRQs that is irq_dispatch(): the handlers
+ * and the EOI, without the softirqs that run afterwards. Recording is a
+ * bit scan and a few increments on the CPU's own counters.
+ *
+ * intstat_dump() prints the count, quantiles and histogram of every vector
+ * taken so far to the log console (Alt+F2). Alt+I calls it.
+ */
+
+/* From a handler with interrupts disabled */
+void intstat_record(size_t vector, uint64_t cycles);
+
+/* Prints every CPU's vectors that were taken at least once */
+void intstat_dump(void);
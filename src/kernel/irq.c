@@ -0,0 +1,153 @@
+#include "irq.h"
+#include "cpu.h"
+#include "idle.h"
+#include "clock.h"
+#include "intstat.h"
+
+struct irq_action {
+    irq_handler_t      handler;
+    void*              ctx;
+    struct irq_action* next;
+};
+
+static struct irq_action actions[IRQ_ACTIONS_MAX];
+static size_t actions_used;
+
+/* the lowest priority line of each PIC, where spurious IRQs show up */
+static constexpr size_t SPURIOUS_MASTER = 7;
+static constexpr size_t SPURIOUS_SLAVE = 15;
+
+struct irq_line {
+    struct irq_action* actions;  /* NULL for masked lines */
+    uint8_t            cpu;
+    uint8_t            priority;
+    uint64_t           max_cycles;  /* longest irq_dispatch() */
+};
+
+static struct irq_line lines[IRQ_LINES];
+
+/* set by irq_init() when the IO-APIC is used */
+static bool apic;
+
+void irq_init(void)
+{
+    apic = apic_init();
+    if (!apic) {
+        pic8259_set_irq_mask(0xffff & ~(1U << IRQ_CASCADE));
+        return;
+    }
+
+    pic8259_set_irq_mask(0xffff);
+    for (size_t line = 0; line < IRQ_LINES; line++) {
+        /* lines that aren't wired stay masked for good */
+        ioapic_route(line, irq_vector(line, 0), 0);
+    }
+}
+
+int irq_register(enum irq line, irq_handler_t handler, void* ctx)
+{
+    if (line >= IRQ_LINES || handler == NULL) {
+        return -1;
+    }
+
+    const uint32_t flags = interrupts_save();
+    if (actions_used == IRQ_ACTIONS_MAX) {
+        interrupts_restore(flags);
+        return -1;
+    }
+
+    struct irq_action* a = &actions[actions_used++];
+    *a = (struct irq_action){.handler = handler, .ctx = ctx};
+
+    struct irq_action** p = &lines[line].actions;
+    while (*p != NULL) {
+        p = &(*p)->next;
+    }
+    *p = a;
+
+    if (apic) {
+        ioapic_mask(line, false);
+    } else {
+        pic8259_clear_irq_mask(1U << line);
+    }
+    interrupts_restore(flags);
+    return 0;
+}
+
+static int route(enum irq line, size_t cpu, size_t priority)
+{
+    if (line >= IRQ_LINES || priority >= IRQ_PRIORITIES) {
+        return -1;
+    }
+    if (!apic) {
+        return cpu == 0 && priority == 0 ? 0 : -1;
+    }
+
+    const uint32_t flags = interrupts_save();
+    const int ret = ioapic_route(line, irq_vector(line, priority), cpu);
+    if (ret == 0) {
+        lines[line].cpu = cpu;
+        lines[line].priority = priority;
+    }
+    interrupts_restore(flags);
+    return ret;
+}
+
+int irq_set_affinity(enum irq line, size_t cpu)
+{
+    return route(line, cpu, line < IRQ_LINES ? lines[line].priority : 0);
+}
+
+int irq_set_priority(enum irq line, size_t priority)
+{
+    return route(line, line < IRQ_LINES ? lines[line].cpu : 0, priority);
+}
+
+void irq_dispatch(size_t line)
+{
+    const uint64_t begin = rdtsc();
+    const size_t vector = irq_vector(line, lines[line].priority);
+    if (!apic && (line == SPURIOUS_MASTER || line == SPURIOUS_SLAVE)
+     && !(pic8259_get_isr() & (1U << line)))
+    {
+        if (line == SPURIOUS_SLAVE) {
+            /* the master did see the cascade line */
+            outb(PIC1_COMMAND, OCW2_EOI);
+        }
+        intstat_record(vector, rdtsc() - begin);
+        return;
+    }
+
+    for (const struct irq_action* a = lines[line].actions; a != NULL; a = a->next) {
+        a->handler(a->ctx);
+    }
+    /* handlers may have left work for the main loop */
+    idle_kick(cpu_current());
+
+    if (apic) {
+        apic_eoi();
+    } else {
+        if (line >= 8) {
+            outb(PIC2_COMMAND, OCW2_EOI);
+        }
+        outb(PIC1_COMMAND, OCW2_EOI);
+    }
+
+    const uint64_t cycles = rdtsc() - begin;
+    if (cycles > lines[line].max_cycles) {
+        lines[line].max_cycles = cycles;
+    }
+    intstat_record(vector, cycles);
+}
+
+uint64_t irq_max_ns(enum irq line)
+{
+    if (line >= IRQ_LINES) {
+        return 0;
+    }
+    /* two loads on i686 */
+    const uint32_t flags = interrupts_save();
+    const uint64_t cycles = lines[line].max_cycles;
+    interrupts_restore(flags);
+    return clock_cycles_to_ns(cycles);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "kernel_state.h" /* IDT_DESC_PIC1 */
+#include "pic.h"
+#include "apic.h"
+
+/*
+ * IRQ dispatch
+ * ============
+ * The 16 ISA IRQ lines enter through the stubs in interrupts.c (irq_entries),
+ * which all end up in irq_dispatch(). It calls every handler registered for
+ * the line in registration order, so a line can be shared, then sends the
+ * EOI: lines 8 to 15 come through the slave PIC and need one on both.
+ * Handlers should leave anything slow to a softirq (softirq.h).
+ *
+ * Lines without a handler stay masked. IRQ 7 and 15 are also raised
+ * spuriously when a request goes away before the CPU takes it, those are
+ * recognized by the missing in-service bit and not acknowledged, except on
+ * the master for a spurious 15.
+ *
+ * If apic_init() finds an IO-APIC the PICs are masked and the lines go
+ * through the IO-APIC instead, acknowledged with one local APIC EOI. Only
+ * then can a line be sent to another CPU with irq_set_affinity() or be
+ * given a priority with irq_set_priority(). A line's priority picks its
+ * vector, IDT_DESC_PIC1 + 16 * priority + line, so every priority is a
+ * separate local APIC priority class. With the PICs every line is on CPU 0
+ * at priority 0 and the PIC orders them by line number.
+ */
+constexpr size_t IRQ_LINES = 16;
+constexpr size_t IRQ_ACTIONS_MAX = 32; /* handlers over all lines */
+constexpr size_t IRQ_PRIORITIES = 4;
+_Static_assert(IDT_DESC_PIC2 == IDT_DESC_PIC1 + 8);
+_Static_assert(IDT_DESC_PIC1 + 16 * IRQ_PRIORITIES <= IDT_DESC_INTERRUPT_SYSCALL);
+
+typedef void (*irq_handler_t)(void* ctx);
+
+/* Masks every line, after pic8259_remap(). Uses the IO-APIC if there is
+ * one, otherwise unmasks the cascade */
+void irq_init(void);
+
+/* Adds a handler for `line` and unmasks it. Handlers run with interrupts
+ * disabled. Returns -1 if the line doesn't exist or IRQ_ACTIONS_MAX
+ * handlers are registered already */
+int irq_register(enum irq line, irq_handler_t handler, void* ctx);
+
+/* Delivers `line` to CPU `cpu`, see apic_cpu_count(). Returns -1 for a
+ * CPU that doesn't exist and for any CPU but 0 without an IO-APIC */
+int irq_set_affinity(enum irq line, size_t cpu);
+
+/* Moves `line` to vector irq_vector(line, priority), higher priorities are
+ * taken first. Returns -1 if priority >= IRQ_PRIORITIES and for any
+ * priority but 0 without an IO-APIC */
+int irq_set_priority(enum irq line, size_t priority);
+
+/* Runs the handlers of `line` and acknowledges it, called by the stubs.
+ * The stubs then run queued softirqs (softirq.h) with interrupts enabled */
+void irq_dispatch(size_t line);
+
+/* longest time spent in irq_dispatch() for `line` with interrupts disabled,
+ * handlers and EOI, 0 before clock_init() */
+uint64_t irq_max_ns(enum irq line);
+
+/* with the PICs always priority 0, where lines 8 to 15 are IDT_DESC_PIC2
+ * onwards */
+static inline size_t irq_vector(size_t line, size_t priority)
+{
+    return IDT_DESC_PIC1 + 16 * priority + line;
+}
@@ -0,0 +1,369 @@
+#include "kbench.h"
+#include "libc.h"
+#include "cpu.h"
+#include "clock.h"
+#include "fbcon.h"
+#include "fmt.h"
+#include "interrupts.h"
+#include "kernel_state.h"
+#include "klog.h"
+#include "malloc.h"
+#include "page.h"
+#include "pic.h"
+#include "timer.h"
+#include "tty.h"
+#include "drivers/serial.h"
+
+/* defined in kernel.c, identity maps the first 4 MiB */
+extern uint32_t page_table[1024];
+
+/*
+ * Benchmarks
+ * ==========
+ * There is no scheduler yet, so there is no context switch to measure. Add
+ * it here once there is one.
+ */
+static void op_empty(size_t)
+{
+}
+
+/* one reading of the clocksource */
+static volatile uint64_t clock_sink;
+
+static void op_clock(size_t)
+{
+    clock_sink = clock_monotonic_ns();
+}
+
+/* int 0x80 round trip from ring 0, including the klog write the handler
+ * does */
+static void op_syscall(size_t)
+{
+    __asm__ volatile ("int $0x80" ::: "memory");
+}
+
+/* klog_dump() formats to the terminal, keep it out of the timed part */
+static void setup_syscall(void)
+{
+    klog_dump();
+}
+
+/* IRQ 2 is the cascade line and never raised by hardware, the EOI
+ * irq_dispatch() sends is ignored with nothing in service. That EOI is a
+ * port write to the PIC, or a store to the local APIC with an IO-APIC */
+static void op_irq(size_t)
+{
+    __asm__ volatile ("int %0" :: "i"(IDT_DESC_PIC1 + 2) : "memory");
+}
+
+/*
+ * Timer ticks with TICK_TIMERS timeouts pending that add themselves again
+ * at spread out delays, so a tick runs a few of them and cascades now and
+ * then. Raised with int like op_irq(), the difference between the two is
+ * the cost of a tick. These ticks count towards timer_ticks(). Measures
+ * cycles per tick.
+ */
+static constexpr size_t TICK_TIMERS = 256;
+static struct timer tick_timers[TICK_TIMERS];
+
+static void tick_timer(void* ctx)
+{
+    struct timer* t = ctx;
+    timer_add(t, 1 + (t - tick_timers) * 37 % 1000, tick_timer, t);
+}
+
+static void op_timer_tick(size_t)
+{
+    __asm__ volatile ("int %0" :: "i"(IDT_DESC_PIC1 + IRQ_SYSTEM_TIMER) : "memory");
+}
+
+static void setup_timer_tick(void)
+{
+    for (size_t i = 0; i < TICK_TIMERS; i++) {
+        if (!timer_pending(&tick_timers[i])) {
+            tick_timer(&tick_timers[i]);
+        }
+    }
+}
+
+/*
+ * An interrupt handler that prints a line, like a driver reporting an
+ * event. It takes the vector of IRQ 3 (COM2), which nothing uses. Measures
+ * cycles per interrupt, once with synchronous output and once with the
+ * output queued.
+ */
+static constexpr size_t PRINT_VECTOR = IDT_DESC_PIC1 + 3;
+
+__attribute__((interrupt))
+static void bench_print_irq(struct interrupt_frame* frame)
+{
+    static uint32_t events;
+    (void)frame;
+    printf(str_attach("irq: event {u32}\n"), ++events);
+}
+
+static void op_irq_print(size_t)
+{
+    __asm__ volatile ("int %0" :: "i"(PRINT_VECTOR) : "memory");
+}
+
+static void setup_irq_print(void)
+{
+    terminal_async_stop();
+}
+
+/* a round queues 2 KiB, a record for each of the three pieces of a line */
+static void setup_irq_print_async(void)
+{
+    terminal_drain();
+    terminal_async_start();
+}
+
+/*
+ * A not-present fault on a page of our own. bench_page_fault() maps the
+ * page back and returns, which retries the access. The timed operation
+ * includes unmapping the page again.
+ */
+static uint8_t fault_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+static inline void invlpg(const void* addr)
+{
+    __asm__ volatile ("invlpg (%0)" :: "r"(addr) : "memory");
+}
+
+__attribute__((interrupt))
+static void bench_page_fault(struct interrupt_frame* frame, uword_t err)
+{
+    (void)frame;
+    (void)err;
+    uint32_t addr;
+    __asm__ volatile ("mov %%cr2, %0" : "=r"(addr));
+    if (addr / PAGE_SIZE >= sizeof page_table / sizeof *page_table) {
+        panic(str_attach("kbench: page fault outside of the identity mapping\n"));
+    }
+    page_table[addr / PAGE_SIZE] |= PTE_PRESENT;
+    invlpg((void*)addr);
+}
+
+static void op_page_fault(size_t i)
+{
+    volatile uint8_t* p = fault_page;
+    page_table[(uint32_t)p / PAGE_SIZE] &= ~PTE_PRESENT;
+    invlpg(fault_page);
+    p[i % PAGE_SIZE] = i;
+}
+
+/* kalloc() is a bump allocator with a 1 MiB heap, keep the total small */
+static void op_kalloc(size_t i)
+{
+    void* p = kalloc(16);
+    ((volatile uint8_t*)p)[0] = i;
+    kfree(p);
+}
+
+/* full lines, so every line scrolls the screen. Measures cycles per
+ * character */
+static void op_tty(size_t i)
+{
+    terminal_putchar(i % (VGA_WIDTH + 1) == VGA_WIDTH ? '\n' : 'a' + i % 26);
+}
+
+static const char long_line[VGA_WIDTH * VGA_HEIGHT] = {[0 ... VGA_WIDTH * VGA_HEIGHT - 1] = 'x'};
+
+/* a screen worth of text without newlines, in cycles per write */
+static void op_tty_long(size_t)
+{
+    terminal_write((struct str){.data = long_line, .len = sizeof long_line});
+}
+
+/* log style output, in cycles per write */
+static void op_tty_short(size_t)
+{
+    terminal_write(str_attach("kalloc: 16 bytes\n"));
+}
+
+/* the same on a console that isn't on screen */
+static void op_tty_background(size_t)
+{
+    const size_t console = terminal_select(TERMINAL_LOG_CONSOLE);
+    terminal_write(str_attach("kalloc: 16 bytes\n"));
+    terminal_select(console);
+}
+
+/* one character through the glyph cache, in cycles per character */
+static void op_fb_char(size_t i)
+{
+    const uint16_t cell = ('a' + i % 26) | vga_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK) << 8;
+    fbcon_draw(i % VGA_WIDTH, i / VGA_WIDTH % VGA_HEIGHT, &cell, 1);
+}
+
+/* the whole text area moved up one row, in cycles per scroll */
+static void op_fb_scroll(size_t)
+{
+    fbcon_scroll(1);
+}
+
+/*
+ * 64 byte writes to COM1, looped back so they don't end up in the results.
+ * The last write of a round waits for the transmitter to go idle, so both
+ * variants are charged for every byte. Measures cycles per write.
+ */
+static constexpr size_t SERIAL_WRITES = 64;
+static const char serial_line[64] = {[0 ... 62] = 's', [63] = '\n'};
+
+static void op_serial(size_t i)
+{
+    serial_write((struct str){.data = serial_line, .len = sizeof serial_line});
+    if (i == SERIAL_WRITES - 1) {
+        serial_flush();
+    }
+}
+
+static void setup_serial_irq(void)
+{
+    if (serial_start_interrupts() < 0) {
+        panic(str_attach("kbench: no IRQ for COM1\n"));
+    }
+}
+
+static const struct kbench benchmarks[] = {
+    {str_attach("empty"),            1024, NULL,                  op_empty},
+    {str_attach("clock_ns"),         1024, NULL,                  op_clock},
+    {str_attach("syscall"),          128,  setup_syscall,         op_syscall},
+    {str_attach("irq"),              1024, NULL,                  op_irq},
+    {str_attach("timer_tick"),       1024, setup_timer_tick,      op_timer_tick},
+    /* irq_print goes back to synchronous output, keep it second */
+    {str_attach("irq_print_async"),  64,   setup_irq_print_async, op_irq_print},
+    {str_attach("irq_print"),        64,   setup_irq_print,       op_irq_print},
+    {str_attach("page_fault"),       256,  NULL,                  op_page_fault},
+    {str_attach("kalloc"),           64,   NULL,                  op_kalloc},
+    {str_attach("tty_scroll"),       2048, NULL,                  op_tty},
+    {str_attach("tty_long"),         16,   NULL,                  op_tty_long},
+    {str_attach("tty_short"),        512,  NULL,                  op_tty_short},
+    {str_attach("tty_bg"),           512,  NULL,                  op_tty_background},
+};
+
+/* only with a framebuffer console */
+static const struct kbench fb_benchmarks[] = {
+    {str_attach("fb_char"),    2000, NULL,          op_fb_char},
+    {str_attach("fb_scroll"),  16,   NULL,          op_fb_scroll},
+};
+
+/* run by run_serial() */
+static const struct kbench serial_benchmarks[] = {
+    {str_attach("serial_polled"), SERIAL_WRITES, NULL,             op_serial},
+    {str_attach("serial_irq"),    SERIAL_WRITES, setup_serial_irq, op_serial},
+};
+
+/*
+ * Harness
+ * =======
+ */
+static void sort(uint32_t* a, size_t n)
+{
+    for (size_t i = 1; i < n; i++) {
+        const uint32_t x = a[i];
+        size_t j = i;
+        for (; j > 0 && a[j - 1] > x; j--) {
+            a[j] = a[j - 1];
+        }
+        a[j] = x;
+    }
+}
+
+static void serial_u32(uint32_t n)
+{
+    char buf[FMT_BUF_MAX];
+    serial_write(fmt_u32(buf, n));
+}
+
+static void report(struct str name, uint32_t* samples, size_t runs)
+{
+    sort(samples, runs);
+    /* nearest rank */
+    const size_t p99 = (runs * 99 + 99) / 100 - 1;
+
+    serial_write(str_attach("{\"suite\":\"kernel\",\"name\":\""));
+    serial_write(name);
+    serial_write(str_attach("\",\"median_cycles\":"));
+    serial_u32(samples[runs / 2]);
+    serial_write(str_attach(",\"p99_cycles\":"));
+    serial_u32(samples[p99]);
+    serial_write(str_attach(",\"median_ns\":"));
+    serial_u32(clock_cycles_to_ns(samples[runs / 2]));
+    serial_write(str_attach(",\"p99_ns\":"));
+    serial_u32(clock_cycles_to_ns(samples[p99]));
+    serial_write(str_attach(",\"runs\":"));
+    serial_u32(runs);
+    serial_write(str_attach("}\n"));
+}
+
+static void measure(const struct kbench* b, uint32_t* samples)
+{
+    for (size_t run = 0; run < KBENCH_WARMUP + KBENCH_RUNS; run++) {
+        if (b->setup != NULL) {
+            b->setup();
+        }
+        const uint64_t begin = rdtsc();
+        for (size_t i = 0; i < b->ops; i++) {
+            b->op(i);
+        }
+        const uint64_t end = rdtsc();
+        if (run >= KBENCH_WARMUP) {
+            /* rounds are far below 2^32 cycles */
+            samples[run - KBENCH_WARMUP] = (uint32_t)(end - begin) / b->ops;
+        }
+    }
+}
+
+static void run_one(const struct kbench* b)
+{
+    uint32_t samples[KBENCH_RUNS];
+    measure(b, samples);
+    report(b->name, samples, KBENCH_RUNS);
+}
+
+/* back to polled, without loopback, for the report */
+static void run_serial(const struct kbench* b)
+{
+    uint32_t samples[KBENCH_RUNS];
+    serial_loopback(true);
+    measure(b, samples);
+    serial_init();
+    report(b->name, samples, KBENCH_RUNS);
+}
+
+void kbench_run(void)
+{
+    serial_init();
+
+    kernel.idt[IDT_DESC_EXCEPTION_PAGE_FAULT] = idt_encode_descriptor(
+            bench_page_fault,
+            segment(SEGMENT_KERNEL_CODE, SEGMENT_GDT, 0),
+            IDT_DPL_3,
+            IDT_GATE_TYPE_TRAP32);
+    kernel.idt[PRINT_VECTOR] = idt_encode_descriptor(
+            bench_print_irq,
+            segment(SEGMENT_KERNEL_CODE, SEGMENT_GDT, 0),
+            IDT_DPL_3,
+            IDT_GATE_TYPE_INTERRUPT32);
+
+    for (size_t i = 0; i < sizeof benchmarks / sizeof *benchmarks; i++) {
+        run_one(&benchmarks[i]);
+    }
+    for (size_t i = 0; fbcon_active() && i < sizeof fb_benchmarks / sizeof *fb_benchmarks; i++) {
+        run_one(&fb_benchmarks[i]);
+    }
+    for (size_t i = 0; i < sizeof serial_benchmarks / sizeof *serial_benchmarks; i++) {
+        run_serial(&serial_benchmarks[i]);
+    }
+    serial_write(str_attach("{\"done\":true}\n"));
+
+    outb(KBENCH_DEBUG_EXIT_PORT, 0);
+
+    /* not running under QEMU */
+    __asm__ volatile ("cli");
+    while (1) {
+        __asm__ volatile ("hlt");
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "str.h"
+
+/*
+ * In-kernel benchmarks
+ * ====================
+ * Booting with "bench" on the kernel command line (`make bench-kernel`, or
+ * the benchmark entry in grub.cfg) runs every benchmark in kbench.c after
+ * the IDT, PIC and paging are set up, instead of starting ring 3.
+ *
+ * Each benchmark runs KBENCH_WARMUP untimed rounds and KBENCH_RUNS timed
+ * ones, timed with rdtsc. The results go to COM1 as one JSON object per
+ * line, the same shape `make bench` prints for the host benchmarks, in TSC
+ * cycles and converted to nanoseconds with the calibrated TSC (clock.h):
+ *
+ *   {"suite":"kernel","name":"syscall","median_cycles":312,"p99_cycles":407,"median_ns":104,"p99_ns":135,"runs":101}
+ *
+ * followed by a line {"done":true}, then QEMU is terminated through the
+ * isa-debug-exit device. The framebuffer console benchmarks only run when
+ * booted through GRUB, `-kernel` stays in text mode. The serial console
+ * benchmarks put COM1 in loopback mode while they run.
+ */
+constexpr size_t KBENCH_WARMUP = 10;
+constexpr size_t KBENCH_RUNS = 101;
+
+/* isa-debug-exit: QEMU exits with status (value << 1) | 1 */
+constexpr uint16_t KBENCH_DEBUG_EXIT_PORT = 0xf4;
+
+struct kbench {
+    struct str name;
+    size_t     ops;              /* operations per round */
+    void     (*setup)(void);     /* untimed, before every round, may be NULL */
+    void     (*op)(size_t i);
+};
+
+/* Runs all benchmarks and exits QEMU, halts on real hardware */
+__attribute__((noreturn))
+void kbench_run(void);
@@ -9,6 +9,18 @@
 #include "types.h"
 #include "kernel_state.h"
 #include "pic.h"
+#include "irq.h"
+#include "apic.h"
+#include "klog.h"
+#include "timer.h"
+#include "clock.h"
+#include "idle.h"
+#include "softirq.h"
+#include "kbench.h"
+#include "multiboot.h"
+#include "fbcon.h"
+#include "drivers/keyboard.h"
+#include "drivers/serial.h"
 
 #include "page.h"
 
@@ -68,15 +80,113 @@ static void ring3_mode(segment_t udata_segment, segment_t ucode_segment, func_t
 }
 /*-----------------------------------------------*/
 
+static struct str multiboot_cmdline(uint32_t magic, const struct multiboot_info* mbi)
+{
+    if (magic != MULTIBOOT_BOOTLOADER_MAGIC || !(mbi->flags & MULTIBOOT_INFO_CMDLINE)) {
+        return (struct str){0};
+    }
+    const char* s = (const char*)mbi->cmdline;
+    size_t len = 0;
+    while (s[len] != '\0') {
+        len++;
+    }
+    return (struct str){.data = s, .len = len};
+}
+
+/* `flag` is one of the space separated words */
+static bool cmdline_has(struct str cmdline, struct str flag)
+{
+    struct str_split it = str_split(cmdline, ' ');
+    while (true) {
+        const struct str arg = str_split_next(&it);
+        if (arg.data == NULL) {
+            return false;
+        }
+        if (str_eq(arg, flag)) {
+            return true;
+        }
+    }
+}
+
+/* "hz=N" on the command line, TIMER_HZ otherwise */
+static uint32_t cmdline_hz(struct str cmdline)
+{
+    const struct str key = str_attach("hz=");
+    struct str_split it = str_split(cmdline, ' ');
+    while (true) {
+        const struct str arg = str_split_next(&it);
+        if (arg.data == NULL) {
+            return TIMER_HZ;
+        }
+        uint32_t hz;
+        if (arg.len > key.len
+         && str_eq(str_slice(arg, 0, arg.len - key.len), key)
+         && str_to_u32(str_slice(arg, key.len, 0), &hz))
+        {
+            return hz;
+        }
+    }
+}
+
+/* once a second to the log console, compare idle with "periodic" */
+static void report_idle(void* ctx)
+{
+    static uint64_t last_ns, last_idle_ns;
+    static uint32_t last_wakeups;
+    const size_t cpu = cpu_current();
+    const uint64_t now = clock_monotonic_ns();
+    const uint64_t idle = idle_ns(cpu);
+    const uint32_t wakeups = idle_wakeups(cpu);
+    /* in units of 1024 ns, a period of about a second then fits 32 bits
+     * even times 100, and the division isn't a 64-bit libgcc call */
+    const uint32_t period = (now - last_ns) >> 10;
+    const uint32_t idle_period = (idle - last_idle_ns) >> 10;
+    if (period != 0) {
+        const uint32_t percent = idle_period * 100 / period;
+        klog(str_attach("idle: cpu {u32} {u32}% idle, {u32} wakeups/s\n"),
+             (uint32_t)cpu, percent, wakeups - last_wakeups);
+    }
+    last_ns = now;
+    last_idle_ns = idle;
+    last_wakeups = wakeups;
+
+    /* the worst cases so far, only when they change */
+    static uint64_t last_irq_ns[IRQ_LINES], last_softirq_ns;
+    for (size_t line = 0; line < IRQ_LINES; line++) {
+        const uint64_t ns = irq_max_ns(line);
+        if (ns != last_irq_ns[line]) {
+            klog(str_attach("irq: line {u32} max {u32} ns\n"), (uint32_t)line, (uint32_t)ns);
+            last_irq_ns[line] = ns;
+        }
+    }
+    const uint64_t softirq_ns = softirq_max_ns(cpu);
+    if (softirq_ns != last_softirq_ns) {
+        klog(str_attach("softirq: cpu {u32} max {u32} ns\n"), (uint32_t)cpu, (uint32_t)softirq_ns);
+        last_softirq_ns = softirq_ns;
+    }
+
+    timer_add(ctx, timer_hz(), report_idle, ctx);
+}
+
 /**
  * Kernel entrypoint
  * =================
  * The kernel entrypoints sets up the GDT, TSS and IDT and moves to ring 3
  */
-void kernel_main(void)
+void kernel_main(uint32_t multiboot_magic, const struct multiboot_info* mbi)
 {
     __asm__ volatile("cli");
 
+    /* read before paging is enabled, the command line can be anywhere */
+    const struct str cmdline = multiboot_cmdline(multiboot_magic, mbi);
+    const bool bench_mode = cmdline_has(cmdline, str_attach("bench"));
+    const uint32_t hz = cmdline_hz(cmdline);
+    /* the tick keeps running in idle with "periodic" */
+    const bool tickless = !cmdline_has(cmdline, str_attach("periodic"));
+    if (fbcon_init(multiboot_magic, mbi)) {
+        terminal_use_framebuffer();
+    }
+
 
     /* Set up the GDT
 	 * ============== */
@@ -170,24 +280,13 @@ void kernel_main(void)
     kernel.idt[IDT_DESC_EXCEPTION_GENERAL_PROTECTION_FAULT] = mtrap(exception_handler_general_protection_fault);
     kernel.idt[IDT_DESC_EXCEPTION_PAGE_FAULT]               = mtrap(exception_handler_page_fault);
 
-    /* IRQs */
-	kernel.idt[IDT_DESC_PIC1 + 0] = mint(irq_handler_0);
-	kernel.idt[IDT_DESC_PIC1 + 1] = mint(irq_handler_1);
-	kernel.idt[IDT_DESC_PIC1 + 2] = mint(irq_handler_2);
-	kernel.idt[IDT_DESC_PIC1 + 3] = mint(irq_handler_3);
-	kernel.idt[IDT_DESC_PIC1 + 4] = mint(irq_handler_4);
-	kernel.idt[IDT_DESC_PIC1 + 5] = mint(irq_handler_5);
-	kernel.idt[IDT_DESC_PIC1 + 6] = mint(irq_handler_6);
-	kernel.idt[IDT_DESC_PIC1 + 7] = mint(irq_handler_7);
-
-	kernel.idt[IDT_DESC_PIC2 + 0] = mint(irq_handler_8);
-	kernel.idt[IDT_DESC_PIC2 + 1] = mint(irq_handler_9);
-	kernel.idt[IDT_DESC_PIC2 + 2] = mint(irq_handler_10);
-	kernel.idt[IDT_DESC_PIC2 + 3] = mint(irq_handler_11);
-	kernel.idt[IDT_DESC_PIC2 + 4] = mint(irq_handler_12);
-	kernel.idt[IDT_DESC_PIC2 + 5] = mint(irq_handler_13);
-	kernel.idt[IDT_DESC_PIC2 + 6] = mint(irq_handler_14);
-	kernel.idt[IDT_DESC_PIC2 + 7] = mint(irq_handler_15);
+    /* IRQs, the handlers are registered with irq_register() */
+    for (size_t priority = 0; priority < IRQ_PRIORITIES; priority++) {
+        for (size_t line = 0; line < IRQ_LINES; line++) {
+            kernel.idt[irq_vector(line, priority)] = mint(irq_entries[line]);
+        }
+    }
+    kernel.idt[APIC_SPURIOUS_VECTOR] = mint(irq_spurious_entry);
     
     /* Interrupts */
     kernel.idt[IDT_DESC_INTERRUPT_SYSCALL] = mint(interrupt_handler_1);
@@ -202,12 +301,45 @@ void kernel_main(void)
 	 * =========
 	 */
 
-    //irq_set_mask(0xff); /* Disable all IRQs */
+    /* remapped even when the IO-APIC takes over, so that anything the
+     * masked PICs still raise lands on an IRQ vector */
     pic8259_remap(IDT_DESC_PIC1, IDT_DESC_PIC2);
+    irq_init();
+    if (apic_active()) {
+        printf(str_attach("irq: IO-APIC, {u32} CPUs\n"), apic_cpu_count());
+    } else {
+        printf(str_attach("irq: no IO-APIC, using the 8259 PICs\n"));
+    }
+
+    /* drivers unmask their lines with irq_register() */
+    if (keyboard_init() < 0) {
+        printf(str_attach("keyboard: no IRQ\n"));
+    }
+    if (timer_init(hz) < 0) {
+        printf(str_attach("timer: can't tick at {u32} Hz\n"), hz);
+    }
+
+    /* PIT channel 2 is free, interrupts still off */
+    clock_init();
+    printf(str_attach("clock: TSC at {u32} kHz\n"), clock_tsc_khz());
+    if (timer_set_tickless(tickless) < 0) {
+        printf(str_attach("timer: staying periodic\n"));
+    }
+    idle_init();
+    printf(idle_mwait() ? str_attach("idle: mwait\n") : str_attach("idle: hlt\n"));
 
     /* enable interrupts */
     __asm__ volatile("sti");
 
+    /* the benchmarks keep COM1 to themselves */
+    if (!bench_mode) {
+        serial_init();
+        if (serial_start_interrupts() < 0) {
+            printf(str_attach("serial: no IRQ, staying polled\n"));
+        }
+        terminal_use_serial();
+    }
+
     printf(str_attach("setting up paging...\n"));
 
     /**
@@ -227,12 +359,21 @@ void kernel_main(void)
     }
 
     page_directory[0] = ((uint32_t)page_table) | PDE_WRITE | PDE_PRESENT | PDE_USER_ACCESS;
+    /* device memory is mapped with 4 MiB pages */
+    cr4_flags_set(CR4_PSE);
+    fbcon_map(page_directory);
+    apic_map(page_directory);
 
     cr3_set((uint32_t)page_directory);
     cr0_flags_set(CR0_PAGING);
 
     printf(str_attach("done!\n"));
 
+    if (bench_mode) {
+        printf(str_attach("running benchmarks, results go to COM1...\n"));
+        kbench_run();
+    }
+
     printf(str_attach("starting code in ring 3...\n"));
     /* Finally go to ring 3 */
     ring3_mode(segment(SEGMENT_USER_DATA, SEGMENT_GDT, 3),
@@ -241,8 +382,21 @@ void kernel_main(void)
 
     printf(str_attach("back to kernel mode...\n"));
 
-    while (1)
-        /* busy loop */;
+    /* from here on printf() only queues, the loop below draws */
+    terminal_async_start();
+
+    static struct timer idle_report;
+    timer_add(&idle_report, timer_hz(), report_idle, &idle_report);
+
+    /* the idle task, see idle.h */
+    while (1) {
+        /* what IRQ exits left behind */
+        softirq_run(SIZE_MAX);
+        /* format whatever interrupt handlers logged in the meantime */
+        klog_dump();
+        terminal_drain();
+        idle_wait();
+    }
 
     __asm__ volatile ("hlt");
 }
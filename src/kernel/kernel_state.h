@@ -2,6 +2,7 @@
 #pragma once
 
 #include "str.h"
+#include "vma.h"
 #include "tss.h"
 #include "idt.h"
 #include "gdt.h"
@@ -98,6 +99,7 @@ constexpr size_t PROC_MAX = 1024;
 
 struct kernel_process {
     struct interrupt_frame frame;
+    struct vma_tree        vmas; /* mapped regions, looked up on page faults */
 };
 
 /**
@@ -0,0 +1,144 @@
+#include <stdarg.h>
+
+#include "klog.h"
+#include "libc.h"
+#include "tty.h"
+
+static struct klog_ring rings[CPU_MAX];
+
+void klog_write(struct str fmt, size_t words, ...)
+{
+    struct klog_ring* ring = &rings[cpu_current()];
+
+    /* Reserve a slot. A compare-and-swap instead of a plain increment keeps
+     * the ring consistent when an interrupt handler logs while the code it
+     * interrupted is in the middle of klog_write() */
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    do {
+        if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= KLOG_RING_SIZE) {
+            __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->head, &head, head + 1, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    struct klog_record* r = &ring->records[head & (KLOG_RING_SIZE - 1)];
+    r->tsc = rdtsc();
+    r->fmt = fmt.data;
+    r->fmt_len = fmt.len;
+    r->words = words;
+
+    va_list ap;
+    va_start(ap, words);
+    for (size_t i = 0; i < words; i++) {
+        r->args[i] = va_arg(ap, uint32_t);
+    }
+    va_end(ap);
+
+    /* publish */
+    __atomic_store_n(&r->seq, head + 1, __ATOMIC_RELEASE);
+}
+
+/* returns the oldest published record of `ring` or NULL */
+static struct klog_record* ring_peek(struct klog_ring* ring)
+{
+    const uint32_t tail = ring->tail;
+    struct klog_record* r = &ring->records[tail & (KLOG_RING_SIZE - 1)];
+    if (__atomic_load_n(&r->seq, __ATOMIC_ACQUIRE) != tail + 1) {
+        return NULL;
+    }
+    return r;
+}
+
+static void ring_pop(struct klog_ring* ring)
+{
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* returns the CPU whose oldest record is the oldest overall, or -1 */
+static int oldest_cpu(void)
+{
+    int cpu = -1;
+    uint64_t tsc = UINT64_MAX;
+    for (size_t i = 0; i < CPU_MAX; i++) {
+        const struct klog_record* r = ring_peek(&rings[i]);
+        if (r != NULL && r->tsc <= tsc) {
+            tsc = r->tsc;
+            cpu = i;
+        }
+    }
+    return cpu;
+}
+
+size_t klog_dump(void)
+{
+    size_t n = 0;
+    const size_t console = terminal_select(TERMINAL_LOG_CONSOLE);
+
+    for (size_t i = 0; i < CPU_MAX; i++) {
+        const uint32_t dropped = __atomic_exchange_n(&rings[i].dropped, 0, __ATOMIC_RELAXED);
+        if (dropped) {
+            printf(str_attach("[klog] cpu {u32}: {u32} records dropped\n"), i, dropped);
+        }
+    }
+
+    for (int cpu; (cpu = oldest_cpu()) != -1; n++) {
+        struct klog_ring* ring = &rings[cpu];
+        const struct klog_record* r = ring_peek(ring);
+        const uint32_t* a = r->args;
+
+        printf(str_attach("[{u64}] "), r->tsc);
+        /* unused trailing words are ignored by printf */
+        printf((struct str){.data = r->fmt, .len = r->fmt_len},
+               a[0], a[1], a[2], a[3], a[4], a[5]);
+
+        ring_pop(ring);
+    }
+
+    terminal_select(console);
+    return n;
+}
+
+size_t klog_export(void* buf, size_t size)
+{
+    if (size < sizeof(struct klog_export_header)) {
+        return 0;
+    }
+
+    struct klog_export_header header = {
+        .magic = KLOG_EXPORT_MAGIC,
+        .version = KLOG_EXPORT_VERSION,
+        .record_size = sizeof(struct klog_export_record),
+    };
+    uint8_t* out = (uint8_t*)buf + sizeof header;
+    size_t remaining = size - sizeof header;
+
+    for (size_t i = 0; i < CPU_MAX; i++) {
+        header.dropped += __atomic_exchange_n(&rings[i].dropped, 0, __ATOMIC_RELAXED);
+    }
+
+    for (int cpu; remaining >= sizeof(struct klog_export_record)
+                  && (cpu = oldest_cpu()) != -1;)
+    {
+        struct klog_ring* ring = &rings[cpu];
+        const struct klog_record* r = ring_peek(ring);
+
+        struct klog_export_record e = {
+            .tsc = r->tsc,
+            .fmt = (uint32_t)r->fmt,
+            .fmt_len = r->fmt_len,
+            .cpu = cpu,
+            .words = r->words,
+        };
+        memcpy(e.args, r->args, sizeof e.args);
+        memcpy(out, &e, sizeof e);
+
+        ring_pop(ring);
+        out += sizeof e;
+        remaining -= sizeof e;
+        header.count += 1;
+    }
+
+    memcpy(buf, &header, sizeof header);
+    return out - (uint8_t*)buf;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "str.h"
+#include "cpu.h"
+
+/*
+ * Deferred binary log
+ * ===================
+ * klog() stores the format string pointer, a TSC timestamp and the raw
+ * argument words into a lock-free per-CPU ring and returns. Nothing is
+ * formatted and nothing touches the display, so it is cheap enough to call
+ * from interrupt handlers.
+ *
+ * The records are formatted later by klog_dump() (from the kernel main loop
+ * or a debug command) or exported unformatted with klog_export() and decoded
+ * offline against the kernel image.
+ *
+ * Arguments are captured as the 32-bit words they occupy on the i386 stack,
+ * which is exactly what printf() reads back with va_arg() when the record is
+ * replayed. 64-bit values and `struct str` therefore take two words each.
+ * The format string must outlive the record, in practice a str_attach()
+ * literal.
+ */
+
+constexpr size_t KLOG_WORDS_MAX = 6;
+constexpr size_t KLOG_RING_SIZE = 256; /* records per CPU, power of two */
+_Static_assert((KLOG_RING_SIZE & (KLOG_RING_SIZE - 1)) == 0);
+
+struct klog_record {
+    uint32_t    seq;    /* index + 1 once the record is published */
+    uint32_t    words;
+    const char* fmt;
+    size_t      fmt_len;
+    uint64_t    tsc;
+    uint32_t    args[KLOG_WORDS_MAX];
+};
+
+struct klog_ring {
+    uint32_t           head;    /* next index to reserve */
+    uint32_t           tail;    /* next index to consume */
+    uint32_t           dropped;
+    struct klog_record records[KLOG_RING_SIZE];
+};
+
+/* klog() argument word counting, supports up to 6 arguments */
+#define KLOG_W(x)              ((sizeof(x) + sizeof(uint32_t) - 1) / sizeof(uint32_t))
+#define KLOG_W0()              0
+#define KLOG_W1(a)             KLOG_W(a)
+#define KLOG_W2(a, ...)        KLOG_W(a) + KLOG_W1(__VA_ARGS__)
+#define KLOG_W3(a, ...)        KLOG_W(a) + KLOG_W2(__VA_ARGS__)
+#define KLOG_W4(a, ...)        KLOG_W(a) + KLOG_W3(__VA_ARGS__)
+#define KLOG_W5(a, ...)        KLOG_W(a) + KLOG_W4(__VA_ARGS__)
+#define KLOG_W6(a, ...)        KLOG_W(a) + KLOG_W5(__VA_ARGS__)
+#define KLOG_PICK(_1, _2, _3, _4, _5, _6, n, ...) n
+#define KLOG_WORDS(...) \
+    (KLOG_PICK(__VA_ARGS__ __VA_OPT__(,) KLOG_W6, KLOG_W5, KLOG_W4, KLOG_W3, KLOG_W2, KLOG_W1, KLOG_W0)(__VA_ARGS__))
+
+#define klog(fmt, ...)                                                        \
+    do {                                                                      \
+        constexpr size_t klog_words_ = KLOG_WORDS(__VA_ARGS__);               \
+        _Static_assert(klog_words_ <= KLOG_WORDS_MAX, "too many klog arguments"); \
+        klog_write(fmt, klog_words_ __VA_OPT__(,) __VA_ARGS__);               \
+    } while (0)
+
+/* use klog() instead, it computes `words` */
+void klog_write(struct str fmt, size_t words, ...);
+
+/* format and print every pending record, oldest first across all CPUs, to
+ * the log console (Alt+F2). Returns the number of records printed. */
+size_t klog_dump(void);
+
+/*
+ * Binary export
+ * =============
+ * klog_export() drains pending records into `buf` as a klog_export_header
+ * followed by klog_export_record entries. `fmt` is the address of the
+ * format string in the kernel image, an offline decoder resolves it by
+ * reading myos.bin.
+ */
+constexpr uint32_t KLOG_EXPORT_MAGIC = 0x474f4c4b; /* "KLOG" */
+constexpr uint16_t KLOG_EXPORT_VERSION = 1;
+
+struct __attribute__((packed)) klog_export_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint32_t count;
+    uint32_t dropped;
+};
+
+struct __attribute__((packed)) klog_export_record {
+    uint64_t tsc;
+    uint32_t fmt;
+    uint16_t fmt_len;
+    uint8_t  cpu;
+    uint8_t  words;
+    uint32_t args[KLOG_WORDS_MAX];
+};
+
+/* returns the number of bytes written to `buf` */
+size_t klog_export(void* buf, size_t size);
@@ -2,6 +2,7 @@
 #include <limits.h>
 
 #include "kernel_state.h"
+#include "malloc.h"
 #include "libc.h"
 
 static constexpr size_t HEAP_SIZE = 1024*1024;
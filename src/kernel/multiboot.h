@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Multiboot information
+ * =====================
+ * Passed by the bootloader in ebx, see boot.S. The fields between the
+ * command line and the framebuffer are declared but unused.
+ *
+ * https://www.gnu.org/software/grub/manual/multiboot/multiboot.html#Boot-information-format
+ */
+constexpr uint32_t MULTIBOOT_BOOTLOADER_MAGIC = 0x2BADB002;
+
+enum multiboot_info_flags : uint32_t {
+    MULTIBOOT_INFO_MEMORY  = 1<<0,
+    MULTIBOOT_INFO_BOOTDEV = 1<<1,
+    MULTIBOOT_INFO_CMDLINE = 1<<2,
+    MULTIBOOT_INFO_FRAMEBUFFER = 1<<12,
+};
+
+enum multiboot_framebuffer_type : uint8_t {
+    MULTIBOOT_FRAMEBUFFER_INDEXED  = 0,
+    MULTIBOOT_FRAMEBUFFER_RGB      = 1,
+    MULTIBOOT_FRAMEBUFFER_EGA_TEXT = 2,
+};
+
+struct multiboot_info {
+    uint32_t flags;
+    uint32_t mem_lower;
+    uint32_t mem_upper;
+    uint32_t boot_device;
+    uint32_t cmdline; /* physical address of a NUL terminated string */
+    uint32_t mods_count;
+    uint32_t mods_addr;
+    uint32_t syms[4];
+    uint32_t mmap_length;
+    uint32_t mmap_addr;
+    uint32_t drives_length;
+    uint32_t drives_addr;
+    uint32_t config_table;
+    uint32_t boot_loader_name;
+    uint32_t apm_table;
+    uint32_t vbe_control_info;
+    uint32_t vbe_mode_info;
+    uint16_t vbe_mode;
+    uint16_t vbe_interface_seg;
+    uint16_t vbe_interface_off;
+    uint16_t vbe_interface_len;
+
+    uint64_t framebuffer_addr; /* physical */
+    uint32_t framebuffer_pitch; /* bytes per line */
+    uint32_t framebuffer_width;
+    uint32_t framebuffer_height;
+    uint8_t  framebuffer_bpp;
+    uint8_t  framebuffer_type; /* enum multiboot_framebuffer_type */
+    /* for MULTIBOOT_FRAMEBUFFER_RGB, bit position and width of each channel */
+    uint8_t  framebuffer_red_field_position;
+    uint8_t  framebuffer_red_mask_size;
+    uint8_t  framebuffer_green_field_position;
+    uint8_t  framebuffer_green_mask_size;
+    uint8_t  framebuffer_blue_field_position;
+    uint8_t  framebuffer_blue_mask_size;
+};
+_Static_assert(offsetof(struct multiboot_info, framebuffer_addr) == 88);
+_Static_assert(offsetof(struct multiboot_info, framebuffer_blue_mask_size) == 115);
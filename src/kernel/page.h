@@ -115,6 +115,16 @@ static inline void cr3_set(uint32_t page_directory)
         : /* clobbers:  */ "eax"         \
     )
 
+#define cr4_flags_set(flags)            \
+    __asm__ volatile (                  \
+        "mov %%cr4, %%eax\n\t"          \
+        "or %0,     %%eax\n\t"          \
+        "mov %%eax, %%cr4\n\t"          \
+        : /* no outputs */              \
+        : /* inputs:    */ "i"((flags)) \
+        : /* clobbers:  */ "eax"        \
+    )
+
 static pageframe_t kalloc_frame(struct bitmap* frame_map, uint32_t startframe)
 {
     for (size_t i = 0; i < frame_map->bit_count; i++) {
@@ -37,9 +37,9 @@ static inline void irq_clear(enum pic8259_port port, uint8_t mask)
 
 void pic8259_set_irq_mask(uint16_t mask)
 {
-    const uint8_t pic1_mask = mask & 0xF;
+    const uint8_t pic1_mask = mask & 0xFF;
     mask >>= 8;
-    const uint8_t pic2_mask = mask & 0xF;
+    const uint8_t pic2_mask = mask & 0xFF;
 
     if (pic1_mask) {
         irq_set(PIC1_DATA, pic1_mask);
@@ -51,9 +51,9 @@ void pic8259_set_irq_mask(uint16_t mask)
 
 void pic8259_clear_irq_mask(uint16_t mask)
 {
-    const uint8_t pic1_mask = mask & 0xF;
+    const uint8_t pic1_mask = mask & 0xFF;
     mask >>= 8;
-    const uint8_t pic2_mask = mask & 0xF;
+    const uint8_t pic2_mask = mask & 0xFF;
 
     if (pic1_mask) {
         irq_clear(PIC1_DATA, pic1_mask);
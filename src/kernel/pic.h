@@ -24,6 +24,7 @@ static const struct str pic8259_port_str[] = {
 enum irq : uint16_t {
     IRQ_SYSTEM_TIMER          = 0,
     IRQ_KEYBOARD_CONTROLLER   = 1,
+    IRQ_CASCADE               = 2, /* the slave PIC, never raised itself */
     IRQ_SERIAL_COM2           = 3,
     IRQ_SERIAL_COM1           = 4,
     IRQ_LINE_PRINT_TERMINAL_2 = 5,
@@ -40,6 +41,7 @@ enum irq : uint16_t {
 static const struct str irq_str[] = {
     [IRQ_SYSTEM_TIMER         ] = str_attach("IRQ_SYSTEM_TIMER"),
     [IRQ_KEYBOARD_CONTROLLER  ] = str_attach("IRQ_KEYBOARD_CONTROLLER"),
+    [IRQ_CASCADE              ] = str_attach("IRQ_CASCADE"),
     [IRQ_SERIAL_COM2          ] = str_attach("IRQ_SERIAL_COM2"),
     [IRQ_SERIAL_COM1          ] = str_attach("IRQ_SERIAL_COM1"),
     [IRQ_LINE_PRINT_TERMINAL_2] = str_attach("IRQ_LINE_PRINT_TERMINAL_2"),
@@ -169,3 +171,7 @@ void pic8259_remap(int offset1, int offset2);
 void pic8259_set_irq_mask(uint16_t mask);
 
 void pic8259_clear_irq_mask(uint16_t mask);
+
+uint16_t pic8259_get_irr(void);
+
+uint16_t pic8259_get_isr(void);
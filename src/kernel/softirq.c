@@ -0,0 +1,78 @@
+#include "softirq.h"
+#include "cpu.h"
+#include "clock.h"
+#include "idle.h"
+
+struct softirq_cpu {
+    struct softirq*  head;
+    struct softirq** tail;       /* &head when empty */
+    bool             running;
+    uint64_t         max_cycles;
+};
+
+static struct softirq_cpu cpus[CPU_MAX];
+
+void softirq_raise(struct softirq* s)
+{
+    const size_t cpu = cpu_current();
+    struct softirq_cpu* c = &cpus[cpu];
+
+    const uint32_t flags = interrupts_save();
+    if (!s->queued) {
+        s->queued = true;
+        s->next = NULL;
+        if (c->tail == NULL) {
+            c->tail = &c->head;
+        }
+        *c->tail = s;
+        c->tail = &s->next;
+    }
+    interrupts_restore(flags);
+
+    /* in case the IRQ exit leaves it behind */
+    idle_kick(cpu);
+}
+
+size_t softirq_run(size_t max)
+{
+    struct softirq_cpu* c = &cpus[cpu_current()];
+    size_t ran = 0;
+
+    const uint32_t flags = interrupts_save();
+    if (c->running) {
+        interrupts_restore(flags);
+        return 0;
+    }
+    c->running = true;
+
+    while (ran < max && c->head != NULL) {
+        struct softirq* s = c->head;
+        c->head = s->next;
+        if (c->head == NULL) {
+            c->tail = &c->head;
+        }
+        s->queued = false;
+
+        __asm__ volatile ("sti" ::: "memory");
+        const uint64_t begin = rdtsc();
+        s->fn(s->ctx);
+        const uint64_t cycles = rdtsc() - begin;
+        __asm__ volatile ("cli" ::: "memory");
+
+        c->max_cycles = cycles > c->max_cycles ? cycles : c->max_cycles;
+        ran++;
+    }
+
+    c->running = false;
+    interrupts_restore(flags);
+    return ran;
+}
+
+uint64_t softirq_max_ns(size_t cpu)
+{
+    /* two loads on i686 */
+    const uint32_t flags = interrupts_save();
+    const uint64_t cycles = cpus[cpu].max_cycles;
+    interrupts_restore(flags);
+    return clock_cycles_to_ns(cycles);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Deferred interrupt work
+ * =======================
+ * An IRQ handler runs with interrupts disabled, so everything it does adds
+ * to the latency of every other interrupt. A handler should only talk to
+ * its device and hand the rest to a softirq: softirq_raise() queues it on
+ * the current CPU and returns.
+ *
+ * Queued softirqs run in order with interrupts enabled, first on IRQ exit,
+ * after the EOI, up to SOFTIRQ_IRQ_EXIT_MAX of them. Whatever is left runs
+ * in the kernel's idle task, which softirq_raise() kicks (idle.h). They
+ * don't interrupt each other, but IRQ handlers can interrupt them. Like
+ * timer functions they must not sleep.
+ *
+ * Raising a softirq that is already queued does nothing, it runs once. Its
+ * function can raise it again.
+ */
+constexpr size_t SOFTIRQ_IRQ_EXIT_MAX = 8;
+
+typedef void (*softirq_fn_t)(void* ctx);
+
+struct softirq {
+    struct softirq* next;
+    bool            queued;
+    softirq_fn_t    fn;
+    void*           ctx;
+};
+
+#define SOFTIRQ_INIT(f, c) (struct softirq){.fn = (f), .ctx = (c)}
+
+/* Queues `s` to run fn(ctx) on the current CPU, from any context */
+void softirq_raise(struct softirq* s);
+
+/* Runs up to `max` queued softirqs of the current CPU with interrupts
+ * enabled, returns how many ran. Returns 0 at once when called from a
+ * softirq. Leaves interrupts as it found them */
+size_t softirq_run(size_t max);
+
+/* longest single softirq so far on `cpu`, 0 before clock_init() */
+uint64_t softirq_max_ns(size_t cpu);
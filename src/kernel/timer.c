@@ -0,0 +1,177 @@
+#include "timer.h"
+#include "cpu.h"
+#include "clock.h"
+#include "irq.h"
+#include "libc.h"
+#include "drivers/pit.h"
+
+static struct timer_wheel wheel;
+static uint64_t ticks;
+static uint32_t hz;
+
+/* tickless mode, see timer_set_tickless() */
+static bool tickless;
+static bool stopped;        /* channel 0 is in one-shot mode */
+static uint64_t tick_tsc;   /* TSC at the last tick counted */
+static uint32_t tick_cycles;
+
+/* counts the ticks that passed while the tick was stopped */
+static void catch_up(void)
+{
+    if (!stopped) {
+        return;
+    }
+    uint64_t elapsed = rdtsc() - tick_tsc;
+    /* a stop is at most 55 ms, a 32-bit division will do. A longer gap
+     * (interrupts held off) is counted in chunks that fit 32 bits rather
+     * than with a 64-bit libgcc division */
+    const uint32_t chunk = UINT32_MAX / tick_cycles;
+    while (elapsed > UINT32_MAX) {
+        ticks += chunk;
+        tick_tsc += (uint64_t)chunk * tick_cycles;
+        elapsed -= (uint64_t)chunk * tick_cycles;
+    }
+    const uint32_t n = (uint32_t)elapsed / tick_cycles;
+    ticks += n;
+    tick_tsc += (uint64_t)n * tick_cycles;
+}
+
+/* back to periodic ticks after idle, runs the timers that came due */
+static void tick_restart(void)
+{
+    catch_up();
+    stopped = false;
+    pit_set_periodic(hz);
+    timer_wheel_advance(&wheel, ticks);
+}
+
+/* IRQ 0 */
+static void timer_irq(void*)
+{
+    if (stopped) {
+        tick_restart();
+        return;
+    }
+    ticks += 1;
+    if (tickless) {
+        tick_tsc = rdtsc();
+    }
+    timer_wheel_advance(&wheel, ticks);
+}
+
+int timer_init(uint32_t rate)
+{
+    if (rate < TIMER_HZ_MIN || rate > TIMER_HZ_MAX) {
+        return -1;
+    }
+    if (irq_register(IRQ_SYSTEM_TIMER, timer_irq, NULL) < 0) {
+        return -1;
+    }
+    hz = rate;
+    pit_set_periodic(rate);
+    return 0;
+}
+
+uint32_t timer_hz(void)
+{
+    return hz;
+}
+
+int timer_set_tickless(bool on)
+{
+    const uint32_t khz = clock_tsc_khz();
+    if (on && (hz == 0 || khz == 0)) {
+        return -1;
+    }
+
+    const uint32_t flags = interrupts_save();
+    if (on) {
+        /* TSC cycles per tick without overflowing 32 bits */
+        tick_cycles = khz / hz * 1000 + khz % hz * 1000 / hz;
+        tick_tsc = rdtsc();
+    } else if (stopped) {
+        tick_restart();
+    }
+    tickless = on;
+    interrupts_restore(flags);
+    return 0;
+}
+
+void timer_idle_enter(void)
+{
+    const uint64_t next = timer_wheel_next(&wheel);
+    if (!tickless || next <= ticks + 1) {
+        return;
+    }
+    /* the farthest the 16-bit PIT counter reaches */
+    const uint32_t divisor = pit_divisor(hz);
+    const uint64_t max = 0xffff / divisor;
+    const uint64_t idle = next - ticks < max ? next - ticks : max;
+    if (idle > 1) {
+        pit_set_oneshot(idle * divisor);
+        stopped = true;
+    }
+}
+
+void timer_idle_exit(void)
+{
+    if (stopped) {
+        tick_restart();
+    }
+}
+
+uint64_t timer_ticks(void)
+{
+    /* two loads on i686, don't let a tick come in between */
+    const uint32_t flags = interrupts_save();
+    catch_up();
+    const uint64_t now = ticks;
+    interrupts_restore(flags);
+    return now;
+}
+
+uint64_t timer_ms_to_ticks(uint32_t ms)
+{
+    /* split so that nothing overflows 32 bits */
+    return (uint64_t)(ms / 1000) * hz + (ms % 1000 * hz + 999) / 1000;
+}
+
+void timer_add(struct timer* t, uint64_t delay, timer_fn_t fn, void* ctx)
+{
+    const uint32_t flags = interrupts_save();
+    catch_up();
+    timer_wheel_add(&wheel, t, ticks + delay, fn, ctx);
+    interrupts_restore(flags);
+}
+
+bool timer_cancel(struct timer* t)
+{
+    const uint32_t flags = interrupts_save();
+    const bool pending = timer_wheel_cancel(&wheel, t);
+    interrupts_restore(flags);
+    return pending;
+}
+
+void sleep_ticks(uint64_t n)
+{
+    if (hz == 0 || !interrupts_enabled()) {
+        panic(str_attach("sleep: no timer or interrupts disabled\n"));
+    }
+
+    const uint64_t end = timer_ticks() + n;
+    while (true) {
+        __asm__ volatile ("cli" ::: "memory");
+        if (ticks >= end) {
+            break;
+        }
+        /* sti takes effect after hlt starts, a tick can't slip in between
+         * the check and the hlt */
+        __asm__ volatile ("sti\n\thlt" ::: "memory");
+    }
+    __asm__ volatile ("sti" ::: "memory");
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sleep_ticks(timer_ms_to_ticks(ms));
+}
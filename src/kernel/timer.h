@@ -0,0 +1,66 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "timer_wheel.h"
+
+/*
+ * Kernel timers
+ * =============
+ * The PIT raises IRQ 0 timer_hz() times a second, TIMER_HZ unless "hz=N"
+ * is on the kernel command line. Every tick increments the monotonic tick
+ * counter and advances a timer wheel (timer_wheel.h), so adding and
+ * cancelling a timeout is O(1) however many are pending.
+ *
+ * Timer functions run in the IRQ 0 handler with interrupts disabled. They
+ * must not sleep and should be short, they delay every other interrupt.
+ *
+ * Tickless idle
+ * -------------
+ * A periodic tick wakes an idle CPU timer_hz() times a second for nothing.
+ * In tickless mode timer_idle_enter() looks up the next timer instead and
+ * puts the PIT in one-shot mode for that long. Whatever wakes the CPU,
+ * the ticks that passed are counted from the TSC (clock.h), the due timers
+ * run and the periodic tick resumes. The 16-bit PIT counter limits a stop
+ * to about 55 ms, so a fully idle CPU still wakes about 18 times a second.
+ */
+constexpr uint32_t TIMER_HZ = 100;
+constexpr uint32_t TIMER_HZ_MIN = 19;    /* the PIT's slowest rate */
+constexpr uint32_t TIMER_HZ_MAX = 10000;
+
+/* Starts the PIT at `hz` and registers the tick handler. Returns -1 if hz
+ * is out of range or IRQ 0 can't be registered */
+int timer_init(uint32_t hz);
+
+/* 0 before timer_init() */
+uint32_t timer_hz(void);
+
+/* Needs timer_init() and clock_init(), returns -1 otherwise */
+int timer_set_tickless(bool on);
+
+/* For the idle task (idle.h), with interrupts disabled right before it
+ * halts. Stops the tick up to the next timer in tickless mode */
+void timer_idle_enter(void);
+
+/* With interrupts disabled after the halt. Restarts a stopped tick and runs
+ * the timers that came due */
+void timer_idle_exit(void);
+
+/* ticks since timer_init() */
+uint64_t timer_ticks(void);
+
+/* ticks in `ms` milliseconds, rounded up */
+uint64_t timer_ms_to_ticks(uint32_t ms);
+
+/* Runs fn(ctx) `delay` ticks from now, at least one. `t` must not be
+ * pending, see timer_pending() */
+void timer_add(struct timer* t, uint64_t delay, timer_fn_t fn, void* ctx);
+
+/* Returns false if `t` already ran or wasn't added */
+bool timer_cancel(struct timer* t);
+
+/* Halts until `ticks` ticks have passed. Needs interrupts enabled and
+ * timer_init() done, panics otherwise */
+void sleep_ticks(uint64_t ticks);
+
+void sleep_ms(uint32_t ms);
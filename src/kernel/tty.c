@@ -6,15 +6,30 @@
  */
 
 #include "tty.h"
+#include "fbcon.h"
 #include "libc.h"
+#include "fmt.h"
+#include "pic.h" /* outb */
+#include "drivers/serial.h"
 
-static struct terminal_state t = {
-    .row    = 0,
-    .column = 0,
-    .color  = vga_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK),
-    .buf    = (uint16_t*)0xB8000,
+static struct terminal_state consoles[TERMINAL_CONSOLES] = {
+    [0 ... TERMINAL_CONSOLES - 1] = {
+        .row    = 0,
+        .column = 0,
+        .color  = vga_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK),
+        .buf    = (uint16_t*)0xB8000,
+        .cursor = UINT16_MAX, /* not programmed yet */
+    },
 };
 
+/* the console written to, and the one on screen */
+static struct terminal_state* t = &consoles[0];
+static struct terminal_state* active = &consoles[0];
+
+_Static_assert(VGA_HEIGHT <= sizeof consoles[0].dirty_rows * 8, "one dirty bit per row");
+_Static_assert((TERMINAL_HISTORY_SIZE & (TERMINAL_HISTORY_SIZE - 1)) == 0, "history size is a power of two");
+_Static_assert((TERMINAL_QUEUE_SIZE & (TERMINAL_QUEUE_SIZE - 1)) == 0, "queue size is a power of two");
+
 static inline bool isprint(int c)
 {
     return (c >= ' ') && (c <= '~');
@@ -25,76 +40,947 @@ static inline uint16_t vga_entry(unsigned char uc, uint8_t color)
 	return (uint16_t) uc | (uint16_t) color << 8;
 }
 
+/*
+ * Output queue
+ * ============
+ * A record is a header word, type | console << 8 | len << 16, followed by
+ * len bytes padded to whole words. Records don't wrap around the end of
+ * the ring, a QUEUE_PAD record skips the rest instead.
+ *
+ * Writers reserve space by moving `head` with a compare-and-swap, so an
+ * interrupt handler can queue while the code it interrupted is halfway
+ * through queue_text(). The header is stored last and publishes the
+ * record. terminal_drain() zeroes every record it has consumed, so a header
+ * that hasn't been stored yet reads as QUEUE_EMPTY.
+ */
+static constexpr size_t QUEUE_TEXT_MAX = 1024;
+
+enum queue_record : uint8_t {
+    QUEUE_EMPTY,
+    QUEUE_TEXT,
+    QUEUE_COLOR,                             /* len is the color */
+    QUEUE_PAD,                               /* len is the size of the gap */
+};
+
+static struct {
+    bool     on;
+    uint32_t head;                           /* bytes ever reserved */
+    uint32_t tail;                           /* bytes ever consumed */
+    uint32_t dropped;                        /* bytes */
+    uint8_t  buf[TERMINAL_QUEUE_SIZE] __attribute__((aligned(4)));
+} queue;
+
+static inline uint32_t queue_header(enum queue_record type, size_t console, size_t len)
+{
+    return type | console << 8 | len << 16;
+}
+
+static inline size_t queue_record_size(size_t len)
+{
+    return sizeof(uint32_t) + ((len + 3) & ~(size_t)3);
+}
+
+/* Returns the space for a record with len bytes, or NULL if the queue is
+ * full */
+static uint32_t* queue_reserve(size_t len)
+{
+    const size_t size = queue_record_size(len);
+    uint32_t head = __atomic_load_n(&queue.head, __ATOMIC_RELAXED);
+    size_t pad;
+    do {
+        const size_t offset = head & (TERMINAL_QUEUE_SIZE - 1);
+        pad = offset + size > TERMINAL_QUEUE_SIZE ? TERMINAL_QUEUE_SIZE - offset : 0;
+        if (head + pad + size - __atomic_load_n(&queue.tail, __ATOMIC_ACQUIRE) > TERMINAL_QUEUE_SIZE) {
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&queue.head, &head, head + pad + size, true,
+                                          __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (pad != 0) {
+        uint32_t* gap = (uint32_t*)&queue.buf[head & (TERMINAL_QUEUE_SIZE - 1)];
+        __atomic_store_n(gap, queue_header(QUEUE_PAD, 0, pad), __ATOMIC_RELEASE);
+    }
+    return (uint32_t*)&queue.buf[(head + pad) & (TERMINAL_QUEUE_SIZE - 1)];
+}
+
+static void queue_text(struct str s)
+{
+    const size_t console = t - consoles;
+    for (size_t i = 0; i < s.len;) {
+        const size_t len = s.len - i < QUEUE_TEXT_MAX ? s.len - i : QUEUE_TEXT_MAX;
+        uint32_t* r = queue_reserve(len);
+        if (r == NULL) {
+            __atomic_fetch_add(&queue.dropped, s.len - i, __ATOMIC_RELAXED);
+            return;
+        }
+        memcpy(r + 1, s.data + i, len);
+        __atomic_store_n(r, queue_header(QUEUE_TEXT, console, len), __ATOMIC_RELEASE);
+        i += len;
+    }
+}
+
+static void queue_color(uint8_t color)
+{
+    uint32_t* r = queue_reserve(0);
+    if (r != NULL) {
+        __atomic_store_n(r, queue_header(QUEUE_COLOR, t - consoles, color), __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * Shadow buffer
+ * =============
+ */
+static inline size_t shadow_row(size_t y)
+{
+    const size_t r = t->top + y;
+    return r >= VGA_HEIGHT ? r - VGA_HEIGHT : r;
+}
+
+/* y is a shadow row */
+static inline void mark_dirty(size_t y, size_t begin, size_t end)
+{
+    const uint32_t bit = 1U << y;
+    if (!(t->dirty_rows & bit)) {
+        t->dirty_rows |= bit;
+        t->dirty_begin[y] = begin;
+        t->dirty_end[y] = end;
+        return;
+    }
+    if (begin < t->dirty_begin[y]) {
+        t->dirty_begin[y] = begin;
+    }
+    if (end > t->dirty_end[y]) {
+        t->dirty_end[y] = end;
+    }
+}
+
+static inline void mark_all_dirty(void)
+{
+    for (size_t y = 0; y < VGA_HEIGHT; y++) {
+        t->dirty_begin[y] = 0;
+        t->dirty_end[y] = VGA_WIDTH;
+    }
+    t->dirty_rows = (1U << VGA_HEIGHT) - 1;
+    t->scrolled = 0; /* everything is redrawn anyway */
+}
+
+/* Copies cells to VGA memory two at a time, each MMIO write costs about the
+ * same regardless of its width */
+static void vga_copy(volatile uint16_t* dst, const uint16_t* src, size_t n)
+{
+    if (n != 0 && ((uintptr_t)dst & 2)) {
+        *dst++ = *src++;
+        n -= 1;
+    }
+
+    volatile uint32_t* dst32 = (volatile uint32_t*)dst;
+    for (; n >= 2; n -= 2) {
+        uint32_t pair;
+        __builtin_memcpy(&pair, src, sizeof pair);
+        *dst32++ = pair;
+        src += 2;
+    }
+
+    if (n != 0) {
+        *(volatile uint16_t*)dst32 = *src;
+    }
+}
+
+/* y is a screen row, origin the VGA cell shown top left */
+static void draw_cells(size_t origin, size_t y, size_t x, const uint16_t* cells, size_t n)
+{
+    if (t->framebuffer) {
+        fbcon_draw(x, y, cells, n);
+    } else {
+        vga_copy(t->buf + origin + y * VGA_WIDTH + x, cells, n);
+    }
+}
+
+/* Erases the cursor and catches up with scrolling */
+static void framebuffer_prepare(void)
+{
+    if (t->cursor != UINT16_MAX) {
+        const size_t x = t->cursor % VGA_WIDTH;
+        mark_dirty(t->cursor / VGA_WIDTH, x, x + 1);
+        t->cursor = UINT16_MAX;
+    }
+    if (t->scrolled >= VGA_HEIGHT) {
+        mark_all_dirty();
+    }
+    fbcon_scroll(t->scrolled);
+    t->scrolled = 0;
+}
+
+static inline void crtc_write(enum vga_crtc_register reg, uint8_t value)
+{
+    outb(VGA_CRTC_INDEX, reg);
+    outb(VGA_CRTC_DATA, value);
+}
+
+static void flush_cells(void)
+{
+    if (t != active || t->view != 0) {
+        return; /* in the background, or the screen shows history */
+    }
+
+    if (t->framebuffer) {
+        framebuffer_prepare();
+    }
+
+    uint32_t rows = t->dirty_rows;
+    t->dirty_rows = 0;
+
+    while (rows != 0) {
+        const size_t y = __builtin_ctz(rows);
+        rows &= rows - 1;
+
+        /* the screen row this shadow row is shown at */
+        const size_t screen_y = y >= t->top ? y - t->top : y + VGA_HEIGHT - t->top;
+        const size_t begin = t->dirty_begin[y];
+        draw_cells(t->origin, screen_y, begin, t->shadow + y * VGA_WIDTH + begin,
+                   t->dirty_end[y] - begin);
+    }
+
+    /* after the cells, so new rows are never shown before they are drawn */
+    if (!t->framebuffer && t->origin != t->crtc_origin) {
+        crtc_write(VGA_CRTC_START_ADDRESS_LOW, t->origin & 0xff);
+        crtc_write(VGA_CRTC_START_ADDRESS_HIGH, t->origin >> 8);
+        t->crtc_origin = t->origin;
+    }
+}
+
+/*
+ * Hardware cursor
+ * ===============
+ */
+static void cursor_update(void)
+{
+    if (t != active || t->view != 0) {
+        return;
+    }
+
+    if (t->framebuffer) {
+        const size_t r = shadow_row(t->row);
+        fbcon_cursor(t->column, t->row, t->shadow[r * VGA_WIDTH + t->column]);
+        t->cursor = r * VGA_WIDTH + t->column;
+        return;
+    }
+
+    const uint16_t pos = t->origin + t->row * VGA_WIDTH + t->column;
+    if (pos == t->cursor) {
+        return;
+    }
+
+    if (t->cursor == UINT16_MAX) {
+        /* the bootloader may have hidden it, use an underline in the
+         * bottom two scanlines */
+        crtc_write(VGA_CRTC_CURSOR_START, 14);
+        crtc_write(VGA_CRTC_CURSOR_END, 15);
+    }
+
+    crtc_write(VGA_CRTC_CURSOR_LOCATION_LOW, pos & 0xff);
+    crtc_write(VGA_CRTC_CURSOR_LOCATION_HIGH, pos >> 8);
+    t->cursor = pos;
+}
+
+static void flush(void)
+{
+    flush_cells();
+    cursor_update();
+}
+
+void terminal_flush(void)
+{
+    if (!queue.on) {
+        flush();
+    }
+}
+
+void terminal_use_framebuffer(void)
+{
+    for (size_t i = 0; i < TERMINAL_CONSOLES; i++) {
+        consoles[i].framebuffer = true;
+        consoles[i].cursor = UINT16_MAX;
+    }
+    terminal_switch(active - consoles);
+}
+
+void terminal_use_serial(void)
+{
+    for (size_t i = 0; i < TERMINAL_CONSOLES; i++) {
+        consoles[i].serial = true;
+    }
+}
+
+/*
+ * Scrollback
+ * ==========
+ */
+static constexpr size_t HISTORY_RECORD_MAX = 4 + VGA_WIDTH * 3;
+_Static_assert(HISTORY_RECORD_MAX <= UINT8_MAX, "record length fits a byte");
+
+static inline uint8_t history_get(size_t pos)
+{
+    return t->history[pos & (TERMINAL_HISTORY_SIZE - 1)];
+}
+
+static inline void history_put(uint8_t byte)
+{
+    t->history[t->history_head++ & (TERMINAL_HISTORY_SIZE - 1)] = byte;
+}
+
+/* Compresses a row about to scroll off, O(VGA_WIDTH) and at most a couple
+ * of old records are dropped to make room */
+static void history_push(const uint16_t* row)
+{
+    const uint8_t fill = row[VGA_WIDTH - 1] >> 8;
+    size_t chars = VGA_WIDTH;
+    while (chars > 0 && row[chars - 1] == vga_entry(' ', fill)) {
+        chars--;
+    }
+
+    size_t runs = 0;
+    for (size_t i = 0; i < chars; i++) {
+        runs += i == 0 || (row[i] >> 8) != (row[i - 1] >> 8);
+    }
+    const size_t len = 4 + chars + runs * 2;
+
+    while (TERMINAL_HISTORY_SIZE - (t->history_head - t->history_tail) < len) {
+        t->history_tail += history_get(t->history_tail);
+        t->history_lines -= 1;
+    }
+    /* a dropped line the view was on scrolls to the oldest one left */
+    if (t->view > t->history_lines) {
+        t->view = t->history_lines;
+    }
+
+    history_put(len);
+    history_put(chars);
+    history_put(fill);
+    for (size_t i = 0; i < chars; i++) {
+        history_put(row[i] & 0xff);
+    }
+    for (size_t i = 0; i < chars;) {
+        const uint8_t color = row[i] >> 8;
+        size_t n = 1;
+        while (i + n < chars && (row[i + n] >> 8) == color) {
+            n++;
+        }
+        history_put(color);
+        history_put(n);
+        i += n;
+    }
+    history_put(len);
+    t->history_lines += 1;
+
+    /* keep the same lines on screen while browsing */
+    if (t->view != 0 && t->view < t->history_lines) {
+        t->view += 1;
+    }
+}
+
+/* Decodes the record at pos into a row of cells */
+static void history_line(size_t pos, uint16_t* row)
+{
+    const size_t chars = history_get(pos + 1);
+    const uint8_t fill = history_get(pos + 2);
+    size_t color_pos = pos + 3 + chars;
+
+    for (size_t i = 0; i < chars;) {
+        const uint8_t color = history_get(color_pos);
+        const size_t n = history_get(color_pos + 1);
+        color_pos += 2;
+        for (size_t end = i + n; i < end; i++) {
+            row[i] = vga_entry(history_get(pos + 3 + i), color);
+        }
+    }
+    for (size_t i = chars; i < VGA_WIDTH; i++) {
+        row[i] = vga_entry(' ', fill);
+    }
+}
+
+/* Draws history lines followed by the top of the live screen, straight to
+ * the VGA memory on display */
+static void history_draw(void)
+{
+    /* the record shown on the top row, `view` lines back */
+    size_t pos = t->history_head;
+    for (size_t i = 0; i < t->view; i++) {
+        pos -= history_get(pos - 1);
+    }
+
+    uint16_t row[VGA_WIDTH];
+    for (size_t y = 0; y < VGA_HEIGHT; y++) {
+        const uint16_t* src = row;
+        if (y < t->view) {
+            history_line(pos, row);
+            pos += history_get(pos);
+        } else {
+            src = t->shadow + shadow_row(y - t->view) * VGA_WIDTH;
+        }
+        draw_cells(t->crtc_origin, y, 0, src, VGA_WIDTH);
+    }
+}
+
+/*
+ * Requests from interrupt handlers
+ * ================================
+ * In asynchronous mode an interrupt can come in while terminal_drain() is
+ * halfway through the shadow buffer, the dirty spans or the CRTC, so
+ * terminal_switch() and terminal_scrollback() only leave a request that
+ * the next drain carries out. `console` is UINT32_MAX without a switch.
+ */
+static struct {
+    uint32_t console;
+    int32_t  scrollback;
+} requests = {.console = UINT32_MAX};
+
+/* acts on the active console */
+static void scrollback(int n)
+{
+    size_t view = t->view;
+    if (n < 0) {
+        view = (size_t)-n < view ? view + n : 0;
+    } else {
+        view = view + n < t->history_lines ? view + n : t->history_lines;
+    }
+    if (view == t->view) {
+        return;
+    }
+
+    if (t->view == 0) {
+        /* hidden until back on the live screen, cursor_update() restores
+         * its shape. The framebuffer one is drawn over by history_draw() */
+        if (!t->framebuffer) {
+            crtc_write(VGA_CRTC_CURSOR_START, 1 << 5);
+        }
+        t->cursor = UINT16_MAX;
+    }
+    t->view = view;
+
+    if (view != 0) {
+        history_draw();
+    } else {
+        mark_all_dirty();
+        flush();
+    }
+}
+
+void terminal_scrollback(int n)
+{
+    if (queue.on) {
+        __atomic_fetch_add(&requests.scrollback, n, __ATOMIC_RELAXED);
+        return;
+    }
+
+    struct terminal_state* const selected = t;
+    t = active;
+    scrollback(n);
+    t = selected;
+}
+
+/*
+ * Virtual consoles
+ * ================
+ */
+static void switch_console(size_t n)
+{
+    /* the CRTC keeps showing the old console's window until the flush */
+    consoles[n].crtc_origin = active->crtc_origin;
+    active = &consoles[n];
+
+    struct terminal_state* const selected = t;
+    t = active;
+    t->cursor = UINT16_MAX;
+    if (t->view != 0) {
+        if (!t->framebuffer) {
+            crtc_write(VGA_CRTC_CURSOR_START, 1 << 5);
+        }
+        history_draw();
+    } else {
+        mark_all_dirty();
+        flush();
+    }
+    t = selected;
+}
+
+void terminal_switch(size_t n)
+{
+    if (n >= TERMINAL_CONSOLES) {
+        return;
+    }
+    if (queue.on) {
+        /* scrollback asked for before the switch was meant for the old
+         * console */
+        __atomic_store_n(&requests.scrollback, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&requests.console, n, __ATOMIC_RELAXED);
+        return;
+    }
+    switch_console(n);
+}
+
+size_t terminal_select(size_t n)
+{
+    const size_t previous = t - consoles;
+    if (n < TERMINAL_CONSOLES) {
+        t = &consoles[n];
+    }
+    return previous;
+}
+
+/*
+ * Terminal
+ * ========
+ */
 void terminal_clear()
 {
-    t.row = 0,
-    t.column = 0,
-    t.color = vga_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+    t->row = 0,
+    t->column = 0,
+    t->color = vga_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+    t->top = 0;
+    t->origin = 0;
+    t->view = 0;
     for (size_t i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++) {
-        t.buf[i] = vga_entry(' ', t.color);
+        t->shadow[i] = vga_entry(' ', t->color);
     }
+    mark_all_dirty();
+    flush();
 }
 
 void terminal_set_color(uint8_t fg, uint8_t bg)
 {
-    t.color = vga_color(fg, bg);
+    if (queue.on) {
+        queue_color(vga_color(fg, bg));
+        return;
+    }
+    t->color = vga_color(fg, bg);
 }
 
 void terminal_putentryat(char c, uint8_t color, size_t x, size_t y)
 {
-	terminal_buf[y*VGA_WIDTH + x] = vga_entry(c, color);
+    const size_t r = shadow_row(y);
+	t->shadow[r*VGA_WIDTH + x] = vga_entry(c, color);
+	mark_dirty(r, x, x + 1);
+}
+
+static void scroll_one(void)
+{
+    /* the top row becomes the new bottom row */
+    const size_t bottom = t->top;
+    history_push(t->shadow + bottom * VGA_WIDTH);
+    t->top = t->top + 1 == VGA_HEIGHT ? 0 : t->top + 1;
+
+    for (size_t i = 0; i < VGA_WIDTH; i++) {
+        t->shadow[bottom * VGA_WIDTH + i] = vga_entry(' ', t->color);
+    }
+    mark_dirty(bottom, 0, VGA_WIDTH);
+
+    if (t != active) {
+        return; /* redrawn in full when switched to */
+    }
+
+    if (t->framebuffer) {
+        t->scrolled += 1;
+        return;
+    }
+
+    t->origin += VGA_WIDTH;
+    if (t->origin + VGA_WIDTH * VGA_HEIGHT > VGA_MEMORY_CELLS) {
+        /* out of VGA memory, continue at the start with a full copy */
+        t->origin = 0;
+        mark_all_dirty();
+    }
 }
 
 void terminal_scroll(int n)
 {
-	constexpr size_t buf_size = VGA_WIDTH * VGA_HEIGHT; 
+    for (int i = 0; i < n; i++) {
+        scroll_one();
+    }
+    t->row -= n;
+}
 
-	const size_t offset = VGA_WIDTH * n;
-	const size_t len = buf_size - offset;
-    memmove(terminal_buf,
-			terminal_buf + offset,
-			len * sizeof *terminal_buf);
-    for (size_t i = len; i < buf_size; i++) {
-        terminal_buf[i] = vga_entry(' ', t.color);
+/*
+ * Escape sequences
+ * ================
+ */
+static constexpr uint8_t DEFAULT_COLOR = vga_color(VGA_COLOR_LIGHT_GREY, VGA_COLOR_BLACK);
+
+/* ANSI color numbers are RGB bits, VGA ones BGR */
+static const uint8_t ansi_to_vga[8] = {
+    VGA_COLOR_BLACK, VGA_COLOR_RED, VGA_COLOR_GREEN, VGA_COLOR_BROWN,
+    VGA_COLOR_BLUE, VGA_COLOR_MAGENTA, VGA_COLOR_CYAN, VGA_COLOR_LIGHT_GREY,
+};
+
+/* nth parameter, 0 if missing */
+static inline size_t param(size_t n)
+{
+    return n < t->escape_count ? t->escape_params[n] : 0;
+}
+
+/* nth parameter, a missing or 0 count means 1 */
+static inline size_t count_param(size_t n)
+{
+    const size_t p = param(n);
+    return p != 0 ? p : 1;
+}
+
+static void clear_cells(size_t y, size_t begin, size_t end)
+{
+    const size_t r = shadow_row(y);
+    for (size_t x = begin; x < end; x++) {
+        t->shadow[r * VGA_WIDTH + x] = vga_entry(' ', t->color);
     }
-    t.row -= n;
+    mark_dirty(r, begin, end);
 }
 
-void terminal_putchar(int c)
+static void csi_cursor_up(void)
+{
+    const size_t n = count_param(0);
+    t->row = n < t->row ? t->row - n : 0;
+}
+
+static void csi_cursor_down(void)
+{
+    const size_t n = count_param(0);
+    t->row = t->row + n < VGA_HEIGHT ? t->row + n : VGA_HEIGHT - 1;
+}
+
+static void csi_cursor_forward(void)
 {
-	/* clear the cursor marker */
-	terminal_putentryat(' ', t.color, t.column, t.row);
+    const size_t n = count_param(0);
+    t->column = t->column + n < VGA_WIDTH ? t->column + n : VGA_WIDTH - 1;
+}
+
+static void csi_cursor_back(void)
+{
+    const size_t n = count_param(0);
+    t->column = n < t->column ? t->column - n : 0;
+}
+
+static void csi_cursor_position(void)
+{
+    const size_t row = count_param(0);
+    const size_t column = count_param(1);
+    t->row = row < VGA_HEIGHT ? row - 1 : VGA_HEIGHT - 1;
+    t->column = column < VGA_WIDTH ? column - 1 : VGA_WIDTH - 1;
+}
+
+static void csi_erase_line(void)
+{
+    switch (param(0)) {
+    case 0: clear_cells(t->row, t->column, VGA_WIDTH); break;
+    case 1: clear_cells(t->row, 0, t->column + 1);     break;
+    case 2: clear_cells(t->row, 0, VGA_WIDTH);        break;
+    }
+}
+
+static void csi_erase_display(void)
+{
+    const size_t mode = param(0);
+    if (mode > 2) {
+        return;
+    }
+    for (size_t y = 0; y < VGA_HEIGHT; y++) {
+        if ((mode == 0 && y > t->row) || (mode == 1 && y < t->row) || mode == 2) {
+            clear_cells(y, 0, VGA_WIDTH);
+        }
+    }
+    if (mode != 2) {
+        csi_erase_line();
+    }
+}
+
+static void csi_graphics(void)
+{
+    uint8_t fg = t->color & 0xf;
+    uint8_t bg = t->color >> 4;
+
+    /* ESC [ m is a reset too */
+    for (size_t i = 0; i < (t->escape_count ? t->escape_count : 1); i++) {
+        const size_t p = param(i);
+        if (p == 0) {
+            fg = DEFAULT_COLOR & 0xf;
+            bg = DEFAULT_COLOR >> 4;
+        } else if (p == 1) {
+            fg |= 8;
+        } else if (p == 22) {
+            fg &= 7;
+        } else if (p >= 30 && p <= 37) {
+            fg = (fg & 8) | ansi_to_vga[p - 30];
+        } else if (p == 39) {
+            fg = DEFAULT_COLOR & 0xf;
+        } else if (p >= 40 && p <= 47) {
+            bg = ansi_to_vga[p - 40];
+        } else if (p == 49) {
+            bg = DEFAULT_COLOR >> 4;
+        } else if (p >= 90 && p <= 97) {
+            fg = ansi_to_vga[p - 90] | 8;
+        } else if (p >= 100 && p <= 107) {
+            bg = ansi_to_vga[p - 100] | 8;
+        }
+    }
+    t->color = vga_color(fg, bg);
+}
+
+/* by final byte, sequences without an entry are ignored */
+static void (*const csi_handlers[128])(void) = {
+    ['A'] = csi_cursor_up,
+    ['B'] = csi_cursor_down,
+    ['C'] = csi_cursor_forward,
+    ['D'] = csi_cursor_back,
+    ['H'] = csi_cursor_position,
+    ['f'] = csi_cursor_position,
+    ['J'] = csi_erase_display,
+    ['K'] = csi_erase_line,
+    ['m'] = csi_graphics,
+};
+
+static void escape_putchar(int c)
+{
+    if (t->escape == TERMINAL_ESCAPE_START) {
+        if (c == '[') {
+            t->escape = TERMINAL_ESCAPE_CSI;
+            t->escape_count = 0;
+            t->escape_params[0] = 0;
+        } else {
+            t->escape = TERMINAL_ESCAPE_NONE;
+        }
+        return;
+    }
+
+    if (c >= '0' && c <= '9') {
+        if (t->escape_count == 0) {
+            t->escape_count = 1;
+        }
+        uint16_t* p = &t->escape_params[t->escape_count - 1];
+        /* stops growing before uint16_t wraps, every handler treats a value
+         * that large as out of range */
+        if (*p <= (UINT16_MAX - 9) / 10) {
+            *p = *p * 10 + (c - '0');
+        }
+    } else if (c == ';') {
+        if (t->escape_count == 0) {
+            t->escape_count = 1;
+        }
+        if (t->escape_count < TERMINAL_ESCAPE_PARAMS) {
+            t->escape_params[t->escape_count++] = 0;
+        }
+    } else if (c >= 0x40 && c <= 0x7e) {
+        if (csi_handlers[c] != NULL) {
+            csi_handlers[c]();
+        }
+        t->escape = TERMINAL_ESCAPE_NONE;
+    } else if (c < 0x20 || c > 0x7e) {
+        /* not part of a sequence, abandon it */
+        t->escape = TERMINAL_ESCAPE_NONE;
+    }
+    /* intermediate and private marker bytes (' ' to '/', '<' to '?') are
+     * accepted and ignored */
+}
+
+static void screen_putchar(int c)
+{
+    if (t->escape != TERMINAL_ESCAPE_NONE) {
+        escape_putchar(c);
+        return;
+    }
 
     // TODO: implement other control characters
     switch (c) {
 
     case '\n':
-        t.column = 0;
-        t.row += 1;
+        t->column = 0;
+        t->row += 1;
         break;
 
+    case '\x1b':
+        t->escape = TERMINAL_ESCAPE_START;
+        return;
+
     default:
         c = isprint(c) ? c : '?';
-        terminal_putentryat(c, t.color, t.column, t.row);
-        t.column += 1;
-        if (t.column == VGA_WIDTH) {
-            t.column = 0;
-            t.row += 1;
+        terminal_putentryat(c, t->color, t->column, t->row);
+        t->column += 1;
+        if (t->column == VGA_WIDTH) {
+            t->column = 0;
+            t->row += 1;
         }
     }
 
-    if (t.row == VGA_HEIGHT) {
+    if (t->row == VGA_HEIGHT) {
         terminal_scroll(1);
     }
 
-	/* set the cursor marker */
-	terminal_putentryat(' ', vga_color(VGA_COLOR_BLACK, VGA_COLOR_LIGHT_GREY), t.column, t.row);
+    if (c == '\n') {
+        flush_cells();
+    }
+}
+
+/* Same as screen_putchar() for every byte, but a run of printable
+ * characters is written one row segment at a time */
+static void screen_write(struct str str)
+{
+    size_t i = 0;
+    while (i < str.len) {
+        const char c = str.data[i];
+        if (c == '\n' || c == '\x1b' || t->escape != TERMINAL_ESCAPE_NONE) {
+            screen_putchar(c);
+            i += 1;
+            continue;
+        }
+
+        const size_t room = VGA_WIDTH - t->column;
+        size_t n = 0;
+        while (n < room && i + n < str.len && str.data[i + n] != '\n' && str.data[i + n] != '\x1b') {
+            n++;
+        }
+
+        const size_t r = shadow_row(t->row);
+        uint16_t* cell = t->shadow + r * VGA_WIDTH + t->column;
+        for (size_t k = 0; k < n; k++) {
+            const char ch = str.data[i + k];
+            cell[k] = vga_entry(isprint(ch) ? ch : '?', t->color);
+        }
+        mark_dirty(r, t->column, t->column + n);
+        i += n;
+
+        t->column += n;
+        if (t->column == VGA_WIDTH) {
+            t->column = 0;
+            t->row += 1;
+            if (t->row == VGA_HEIGHT) {
+                terminal_scroll(1);
+            }
+        }
+    }
+}
+
+void terminal_putchar(int c)
+{
+    if (queue.on) {
+        const char ch = c;
+        queue_text((struct str){.data = &ch, .len = 1});
+        return;
+    }
+    if (t->serial) {
+        serial_putchar(c);
+    }
+    screen_putchar(c);
 }
 
 void terminal_write(struct str str)
 {
-	for (size_t i = 0; i < str.len; i++) {
-		terminal_putchar(str.data[i]);
+    if (queue.on) {
+        queue_text(str);
+        return;
+    }
+    if (t->serial) {
+        serial_write(str);
+    }
+    screen_write(str);
+    flush();
+}
+
+/*
+ * Draining the output queue
+ * =========================
+ */
+/* to console `t` and its serial copy, like terminal_write() does */
+static void drain_write(struct str text)
+{
+    if (t->serial) {
+        serial_write(text);
+    }
+    screen_write(text);
+}
+
+static void write_dropped(uint32_t bytes)
+{
+    char buf[FMT_BUF_MAX];
+    drain_write(str_attach("[tty] "));
+    drain_write(fmt_u32(buf, bytes));
+    drain_write(str_attach(" bytes of output dropped\n"));
+}
+
+size_t terminal_drain(void)
+{
+    struct terminal_state* const selected = t;
+    size_t n = 0;
+
+    while (true) {
+        const uint32_t tail = queue.tail;
+        uint32_t* r = (uint32_t*)&queue.buf[tail & (TERMINAL_QUEUE_SIZE - 1)];
+        const uint32_t header = __atomic_load_n(r, __ATOMIC_ACQUIRE);
+        const enum queue_record type = header & 0xff;
+        if (type == QUEUE_EMPTY) {
+            break;
+        }
+
+        const size_t len = header >> 16;
+        size_t size = queue_record_size(0);
+        t = &consoles[header >> 8 & 0xff];
+        switch (type) {
+        case QUEUE_TEXT: {
+            drain_write((struct str){.data = (const char*)(r + 1), .len = len});
+            size = queue_record_size(len);
+            n += len;
+            break;
+        }
+        case QUEUE_COLOR:
+            t->color = len;
+            break;
+        case QUEUE_PAD:
+            size = len;
+            break;
+        case QUEUE_EMPTY:
+            break;
+        }
+
+        memset(r, 0, size);
+        __atomic_store_n(&queue.tail, tail + size, __ATOMIC_RELEASE);
+    }
+
+    t = selected;
+    const uint32_t dropped = __atomic_exchange_n(&queue.dropped, 0, __ATOMIC_RELAXED);
+    if (dropped != 0) {
+        write_dropped(dropped);
+    }
+
+    const uint32_t console = __atomic_exchange_n(&requests.console, UINT32_MAX, __ATOMIC_RELAXED);
+    if (console != UINT32_MAX) {
+        switch_console(console);
+    }
+    const int lines = __atomic_exchange_n(&requests.scrollback, 0, __ATOMIC_RELAXED);
+
+    t = active;
+    if (lines != 0) {
+        scrollback(lines);
+    }
+    flush();
+    t = selected;
+    return n;
+}
+
+void terminal_async_start(void)
+{
+    queue.on = true;
+}
+
+void terminal_async_stop(void)
+{
+    if (queue.on) {
+        queue.on = false;
+        terminal_drain();
     }
 }
 
+void terminal_emergency(void)
+{
+    terminal_async_stop();
+    /* polled, after sending whatever it still has */
+    serial_init();
+    terminal_select(0);
+    terminal_switch(0);
+}
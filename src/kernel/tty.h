@@ -15,11 +15,106 @@ static constexpr size_t VGA_HEIGHT = 25;
 
 static uint16_t* const terminal_buf = (uint16_t*)0xB8000;
 
+/* the text mode window at 0xB8000 is 32 KiB, the screen shows VGA_HEIGHT
+ * rows of it starting at the CRTC start address */
+static constexpr size_t VGA_MEMORY_CELLS = 32 * 1024 / sizeof(uint16_t);
+
+/* bytes of compressed scrollback, a power of two */
+static constexpr size_t TERMINAL_HISTORY_SIZE = 32 * 1024;
+
+/* bytes of queued output in asynchronous mode, a power of two */
+static constexpr size_t TERMINAL_QUEUE_SIZE = 16 * 1024;
+
+static constexpr size_t TERMINAL_ESCAPE_PARAMS = 8;
+
+/* virtual consoles, Alt+F1 to Alt+F4 */
+static constexpr size_t TERMINAL_CONSOLES = 4;
+
+/* where klog_dump() output goes */
+static constexpr size_t TERMINAL_LOG_CONSOLE = 1;
+
+enum terminal_escape : uint8_t {
+    TERMINAL_ESCAPE_NONE,
+    TERMINAL_ESCAPE_START,                   /* after ESC */
+    TERMINAL_ESCAPE_CSI,                     /* after ESC [ */
+};
+
+/*
+ * Everything is drawn into `shadow` in RAM. VGA memory is uncached MMIO, so
+ * reading it back and writing a cell more than once is expensive. Changed
+ * cells are tracked as one column span per shadow row and copied to `buf`
+ * at the end of every line and by terminal_flush().
+ *
+ * Scrolling doesn't move any cells. `shadow` is a ring of VGA_HEIGHT rows
+ * with screen row 0 at shadow row `top`, and the screen is a window into
+ * VGA memory starting at cell `origin`. A scroll advances both and only
+ * clears the new bottom row. When the window would run past the end of VGA
+ * memory it moves back to the start, the one time the whole screen is
+ * copied.
+ *
+ * The cursor is the hardware one. Moving it takes four port writes, so it
+ * is only moved by terminal_flush(), once per terminal_write() or printf().
+ *
+ * Rows that scroll off the top are appended to `history`, a byte ring of
+ * variable length records, oldest first:
+ *
+ *   len, chars, fill, char[chars], { color, count }..., len
+ *
+ * Trailing blanks of the `fill` color are dropped and colors are run length
+ * encoded, so a typical line takes a few bytes more than its text. `len` at
+ * both ends lets the ring be walked in either direction. `head` and `tail`
+ * count bytes ever written and dropped, only their low bits index the ring.
+ *
+ * While `view` is non-zero the screen shows history instead and nothing is
+ * copied to VGA memory until the view returns to the live screen.
+ *
+ * ESC [ params final sequences are parsed a byte at a time, `escape` is the
+ * parser state.
+ *
+ * With `framebuffer` set the cells go to fbcon.h instead. Scrolls are
+ * counted in `scrolled` and done by one move of the framebuffer at the next
+ * flush. `cursor` is then the shadow cell under the drawn cursor.
+ *
+ * With `serial` set everything written is also sent to COM1 as is, escape
+ * sequences included.
+ *
+ * There is one terminal_state per virtual console. Output goes to the
+ * selected one, and only the active one (on screen) touches VGA memory, the
+ * CRTC or the framebuffer. The others only update their shadow and history,
+ * which is plain RAM, and are redrawn in full when switched to.
+ */
 struct [[nodiscard]] terminal_state {
     size_t          row;
     size_t          column;
     uint8_t         color;
     uint16_t* const buf;
+
+    size_t          top;                     /* shadow row shown as screen row 0 */
+    size_t          origin;                  /* VGA cell shown top left */
+    size_t          crtc_origin;             /* origin last sent to the CRTC */
+
+    uint32_t        dirty_rows;              /* bit n: shadow row n has changed */
+    uint8_t         dirty_begin[VGA_HEIGHT]; /* changed columns of a row */
+    uint8_t         dirty_end[VGA_HEIGHT];
+
+    uint16_t        cursor;                  /* position last sent to the CRTC */
+
+    bool            framebuffer;
+    size_t          scrolled;                /* rows since the last flush */
+
+    bool            serial;
+
+    size_t          history_head;
+    size_t          history_tail;
+    size_t          history_lines;
+    size_t          view;                    /* lines scrolled back */
+
+    enum terminal_escape escape;
+    uint8_t         escape_count;            /* parameters started */
+    uint16_t        escape_params[TERMINAL_ESCAPE_PARAMS];
+
+    uint16_t        shadow[VGA_WIDTH * VGA_HEIGHT];
+    uint8_t         history[TERMINAL_HISTORY_SIZE];
 };
 
 /* Hardware text mode color constants. */
@@ -44,6 +139,22 @@ enum vga_color : uint8_t {
 
 #define vga_color(fg, bg) (fg | bg << 4)
 
+/* CRT controller, the index register selects which register the data port
+ * accesses */
+enum vga_crtc_port : uint16_t {
+    VGA_CRTC_INDEX = 0x3D4,
+    VGA_CRTC_DATA  = 0x3D5,
+};
+
+enum vga_crtc_register : uint8_t {
+    VGA_CRTC_CURSOR_START         = 0x0A, /* bit 5: disable, bits 0-4: top scanline */
+    VGA_CRTC_CURSOR_END           = 0x0B, /* bits 0-4: bottom scanline */
+    VGA_CRTC_START_ADDRESS_HIGH   = 0x0C, /* first cell shown */
+    VGA_CRTC_START_ADDRESS_LOW    = 0x0D,
+    VGA_CRTC_CURSOR_LOCATION_HIGH = 0x0E,
+    VGA_CRTC_CURSOR_LOCATION_LOW  = 0x0F,
+};
+
 void terminal_clear();
 
 void terminal_set_color(uint8_t fg, uint8_t bg);
@@ -52,6 +163,63 @@ void terminal_putentryat(char c, uint8_t color, size_t x, size_t y);
 
 void terminal_scroll(int n);
 
+/* Moves the view n lines back into the scrollback history, or towards the
+ * live screen if n is negative */
+void terminal_scrollback(int n);
+
+/* Besides printable characters handles '\n' and these escape sequences:
+ *
+ *   ESC [ n A / B / C / D   cursor up / down / forward / back n cells
+ *   ESC [ row ; col H       cursor to row, col (1-based), also f
+ *   ESC [ n J               clear to the end (0), start (1) or all (2) of the screen
+ *   ESC [ n K               same for the line
+ *   ESC [ n ; ... m         colors: 0 reset, 1 bright, 22 normal, 30-37 and
+ *                           90-97 foreground, 40-47 and 100-107 background,
+ *                           39 and 49 default
+ */
 void terminal_putchar(int c);
 
 void terminal_write(struct str str);
+
+/* Copies everything changed since the last flush to VGA memory and moves
+ * the cursor. Does nothing in asynchronous mode, terminal_drain() does it */
+void terminal_flush(void);
+
+/*
+ * Asynchronous mode
+ * =================
+ * After terminal_async_start() terminal_write(), terminal_putchar() and
+ * terminal_set_color() only append a record to a lock-free queue of
+ * TERMINAL_QUEUE_SIZE bytes. That is all an interrupt handler calling
+ * printf() pays for. The kernel's idle loop calls terminal_drain() to draw
+ * the queued output and copy it to COM1. Output that doesn't fit the queue
+ * is dropped and counted.
+ *
+ * Scrollback and switching consoles wait for the next terminal_drain()
+ * too, so that an interrupt handler asking for them can't change the screen
+ * while the drain is drawing it.
+ */
+void terminal_async_start(void);
+
+/* Draws what is queued and goes back to synchronous output */
+void terminal_async_stop(void);
+
+/* Draws everything queued so far, returns the number of bytes */
+size_t terminal_drain(void);
+
+/* For panics: terminal_async_stop(), makes COM1 polled and shows
+ * console 1 */
+void terminal_emergency(void);
+
+/* Shows console n, its screen is redrawn from the shadow */
+void terminal_switch(size_t n);
+
+/* Directs all output to console n until the next call, returns the console
+ * selected before */
+size_t terminal_select(size_t n);
+
+/* Draws to the framebuffer console from now on, see fbcon.h */
+void terminal_use_framebuffer(void);
+
+/* Copies all output to the serial console from now on, see drivers/serial.h */
+void terminal_use_serial(void);
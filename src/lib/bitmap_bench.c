@@ -0,0 +1,55 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "bitmap.h"
+
+/*
+ * Bitmap operations on a map the size of the kernel's page frame map
+ * (4 GiB of 4 KiB frames), including the first-free-bit scan
+ * kalloc_frame() does with bitmap_get().
+ */
+
+static constexpr size_t BITS = 1024 * 1024;
+static constexpr size_t OPS = 4096;
+
+static uint32_t data[BITS / 32];
+
+/* what kalloc_frame() does today */
+__attribute__((noipa))
+static size_t first_free(struct bitmap* b)
+{
+    for (size_t i = 0; i < b->bit_count; i++) {
+        if (bitmap_get(b, i) == 0) {
+            return i;
+        }
+    }
+    return b->bit_count;
+}
+
+int main()
+{
+    struct bitmap b = BITMAP_ATTACH(data, sizeof data);
+    size_t index[OPS];
+
+    srand(1);
+    for (size_t i = 0; i < OPS; i++) {
+        index[i] = rand() % BITS;
+    }
+
+    BENCH("set",   i, OPS, bitmap_set(&b, index[i]));
+    BENCH("get",   i, OPS, bitmap_get(&b, index[i]));
+    BENCH("unset", i, OPS, bitmap_unset(&b, index[i]));
+
+    /* ranges stay below the last word, see bitmap_set_range() */
+    BENCH("set_range/64",      i, OPS, bitmap_set_range(&b, index[i] % (BITS - 128), index[i] % (BITS - 128) + 64));
+    BENCH("clear_range/64",    i, OPS, bitmap_clear_range(&b, index[i] % (BITS - 128), index[i] % (BITS - 128) + 64));
+    BENCH("set_range/65536",   i, 64,  bitmap_set_range(&b, index[i] % (BITS / 2), index[i] % (BITS / 2) + 65536));
+    BENCH("clear_range/65536", i, 64,  bitmap_clear_range(&b, index[i] % (BITS / 2), index[i] % (BITS / 2) + 65536));
+    BENCH("range_empty/65536", i, 64,  bitmap_range_empty(&b, index[i] % (BITS / 2), index[i] % (BITS / 2) + 65536));
+
+    /* the first half of memory is allocated */
+    bitmap_set_range(&b, 0, BITS / 2);
+    BENCH("first_free/524288", i, 4, first_free(&b));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#include "fmt.h"
+
+static const char digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_digits[16] = "0123456789abcdef";
+
+static inline struct str tail(char* buf, char* begin)
+{
+    return (struct str){.data = begin, .len = buf + FMT_BUF_MAX - begin};
+}
+
+/* high 64 bits of a 64x64 bit product, built from 32x32->64 multiplies which
+ * i686 has native instructions for */
+static inline uint64_t mulhi64(uint64_t a, uint64_t b)
+{
+    const uint64_t a0 = (uint32_t)a, a1 = a >> 32;
+    const uint64_t b0 = (uint32_t)b, b1 = b >> 32;
+
+    const uint64_t p00 = a0 * b0;
+    const uint64_t p01 = a0 * b1;
+    const uint64_t p10 = a1 * b0;
+    const uint64_t p11 = a1 * b1;
+
+    const uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    return p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+/* 10^9 = 2^9 * 1953125. After shifting out the power of two the dividend has
+ * at most 55 significant bits, which lets the reciprocal of 1953125 fit in 64
+ * bits (Granlund & Montgomery, "Division by invariant integers using
+ * multiplication", l = 20). */
+uint64_t fmt_div_1e9(uint64_t n)
+{
+    constexpr uint64_t magic = 0x44b82fa09b5a53;
+    return mulhi64(n >> 9, magic) >> 11;
+}
+
+/* writes n in decimal ending right before `end`, returns the first digit */
+static char* put_dec32(char* end, uint32_t n)
+{
+    while (n >= 100) {
+        const uint32_t r = (n % 100) * 2;
+        n /= 100;
+        end -= 2;
+        end[0] = digit_pairs[r];
+        end[1] = digit_pairs[r + 1];
+    }
+    if (n >= 10) {
+        end -= 2;
+        end[0] = digit_pairs[n * 2];
+        end[1] = digit_pairs[n * 2 + 1];
+    } else {
+        *--end = '0' + n;
+    }
+    return end;
+}
+
+/* like put_dec32() but always writes exactly 9 digits, n < 10^9 */
+static char* put_dec9(char* end, uint32_t n)
+{
+    for (int i = 0; i < 4; i++) {
+        const uint32_t r = (n % 100) * 2;
+        n /= 100;
+        end -= 2;
+        end[0] = digit_pairs[r];
+        end[1] = digit_pairs[r + 1];
+    }
+    *--end = '0' + n;
+    return end;
+}
+
+static char* put_dec64(char* end, uint64_t n)
+{
+    while (n >> 32) {
+        const uint64_t q = fmt_div_1e9(n);
+        end = put_dec9(end, (uint32_t)(n - q * 1000000000));
+        n = q;
+    }
+    return put_dec32(end, (uint32_t)n);
+}
+
+/* writes at least `min_digits` hex digits of n ending right before `end` */
+static char* put_hex32(char* end, uint32_t n, int min_digits)
+{
+    char* const stop = end - min_digits;
+    do {
+        *--end = hex_digits[n & 0xf];
+        n >>= 4;
+    } while (n || end > stop);
+    return end;
+}
+
+static char* put_bin32(char* end, uint32_t n, int min_digits)
+{
+    char* const stop = end - min_digits;
+    do {
+        *--end = '0' + (n & 1);
+        n >>= 1;
+    } while (n || end > stop);
+    return end;
+}
+
+struct str fmt_u32(char buf[static FMT_BUF_MAX], uint32_t n)
+{
+    return tail(buf, put_dec32(buf + FMT_BUF_MAX, n));
+}
+
+struct str fmt_i32(char buf[static FMT_BUF_MAX], int32_t n)
+{
+    char* p = put_dec32(buf + FMT_BUF_MAX, n < 0 ? -(uint32_t)n : (uint32_t)n);
+    if (n < 0) {
+        *--p = '-';
+    }
+    return tail(buf, p);
+}
+
+struct str fmt_u64(char buf[static FMT_BUF_MAX], uint64_t n)
+{
+    return tail(buf, put_dec64(buf + FMT_BUF_MAX, n));
+}
+
+struct str fmt_i64(char buf[static FMT_BUF_MAX], int64_t n)
+{
+    char* p = put_dec64(buf + FMT_BUF_MAX, n < 0 ? -(uint64_t)n : (uint64_t)n);
+    if (n < 0) {
+        *--p = '-';
+    }
+    return tail(buf, p);
+}
+
+struct str fmt_x32(char buf[static FMT_BUF_MAX], uint32_t n)
+{
+    return tail(buf, put_hex32(buf + FMT_BUF_MAX, n, 1));
+}
+
+/* the 64-bit variants work on 32-bit halves so i686 never shifts a register
+ * pair per digit */
+struct str fmt_x64(char buf[static FMT_BUF_MAX], uint64_t n)
+{
+    const uint32_t hi = n >> 32;
+    char* p = put_hex32(buf + FMT_BUF_MAX, (uint32_t)n, hi ? 8 : 1);
+    if (hi) {
+        p = put_hex32(p, hi, 1);
+    }
+    return tail(buf, p);
+}
+
+struct str fmt_b32(char buf[static FMT_BUF_MAX], uint32_t n)
+{
+    return tail(buf, put_bin32(buf + FMT_BUF_MAX, n, 1));
+}
+
+struct str fmt_b64(char buf[static FMT_BUF_MAX], uint64_t n)
+{
+    const uint32_t hi = n >> 32;
+    char* p = put_bin32(buf + FMT_BUF_MAX, (uint32_t)n, hi ? 32 : 1);
+    if (hi) {
+        p = put_bin32(p, hi, 1);
+    }
+    return tail(buf, p);
+}
@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "fmt.h"
+
+/*
+ * Compares fmt_*() with the one-digit-per-division loop printf used before
+ * (print_long()), writing into a buffer instead of the terminal.
+ */
+
+static constexpr size_t VALUE_COUNT = 4096;
+
+static uint64_t values[VALUE_COUNT];
+
+__attribute__((noipa))
+static size_t naive_u64(char* buf, size_t buf_size, uint64_t n, struct str alphabet)
+{
+    size_t i = 0;
+
+    if (n == 0) {
+        buf[buf_size - 1] = '0';
+        return 1;
+    }
+
+    while (n) {
+        i += 1;
+        buf[buf_size - i] = alphabet.data[n % alphabet.len];
+        n /= alphabet.len;
+    }
+
+    return i;
+}
+
+int main()
+{
+    const struct str dec = str_attach("0123456789");
+    const struct str hex = str_attach("0123456789abcdef");
+    char buf[FMT_BUF_MAX];
+
+    srand(1);
+    for (size_t i = 0; i < VALUE_COUNT; i++) {
+        values[i] = ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 11) ^ rand();
+    }
+
+    BENCH("naive_u32", i, VALUE_COUNT, naive_u64(buf, sizeof buf, (uint32_t)values[i], dec));
+    BENCH("fmt_u32",   i, VALUE_COUNT, fmt_u32(buf, (uint32_t)values[i]).len);
+    BENCH("naive_x32", i, VALUE_COUNT, naive_u64(buf, sizeof buf, (uint32_t)values[i], hex));
+    BENCH("fmt_x32",   i, VALUE_COUNT, fmt_x32(buf, (uint32_t)values[i]).len);
+
+    BENCH("naive_u64", i, VALUE_COUNT, naive_u64(buf, sizeof buf, values[i], dec));
+    BENCH("fmt_u64",   i, VALUE_COUNT, fmt_u64(buf, values[i]).len);
+    BENCH("naive_x64", i, VALUE_COUNT, naive_u64(buf, sizeof buf, values[i], hex));
+    BENCH("fmt_x64",   i, VALUE_COUNT, fmt_x64(buf, values[i]).len);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,243 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include <inttypes.h>
+#include "fmt.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+static bool str_eq_cstr(struct str s, const char* cstr)
+{
+    return s.len == strlen(cstr) && memcmp(s.data, cstr, s.len) == 0;
+}
+
+/* xorshift64, deterministic so failures are reproducible */
+static uint64_t rng_state = 0x9E3779B97F4A7C15;
+static uint64_t rng(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/* random values with a uniformly distributed bit length, so short numbers are
+ * covered as well as long ones */
+static uint64_t rng_value(void)
+{
+    const unsigned bits = rng() % 65;
+    return bits == 64 ? rng() : rng() & ((1ULL << bits) - 1);
+}
+
+static void bin_reference(char* out, uint64_t n)
+{
+    char tmp[65];
+    int i = 0;
+    do {
+        tmp[i++] = '0' + (n & 1);
+        n >>= 1;
+    } while (n);
+    for (int j = 0; j < i; j++) {
+        out[j] = tmp[i - 1 - j];
+    }
+    out[i] = '\0';
+}
+
+static const uint64_t edge_values[] = {
+    0, 1, 9, 10, 11, 99, 100, 101, 999, 1000,
+    999999999, 1000000000, 1000000001,
+    UINT32_MAX - 1, UINT32_MAX, (uint64_t)UINT32_MAX + 1,
+    999999999999999999ULL, 1000000000000000000ULL,
+    (uint64_t)INT64_MAX, (uint64_t)INT64_MAX + 1,
+    UINT64_MAX - 1, UINT64_MAX,
+};
+
+int main()
+{
+    char buf[FMT_BUF_MAX];
+    char expected[128];
+    constexpr size_t random_rounds = 1000000;
+
+    test_begin("fmt_div_1e9()");
+    do {
+        bool ok = true;
+        for (size_t i = 0; i < sizeof edge_values / sizeof *edge_values; i++) {
+            const uint64_t n = edge_values[i];
+            if (fmt_div_1e9(n) != n / 1000000000) {
+                test_fail("fmt_div_1e9(%" PRIu64 ") returned %" PRIu64, n, fmt_div_1e9(n));
+                ok = false;
+                break;
+            }
+        }
+        for (size_t i = 0; ok && i < random_rounds; i++) {
+            const uint64_t n = rng_value();
+            if (fmt_div_1e9(n) != n / 1000000000) {
+                test_fail("fmt_div_1e9(%" PRIu64 ") returned %" PRIu64, n, fmt_div_1e9(n));
+                ok = false;
+            }
+        }
+        if (ok) {
+            test_ok("fmt_div_1e9() matches native division");
+        }
+    } while (0);
+
+    test_begin("32-bit conversions of edge values");
+    do {
+        bool ok = true;
+        for (size_t i = 0; ok && i < sizeof edge_values / sizeof *edge_values; i++) {
+            const uint32_t n = (uint32_t)edge_values[i];
+
+            snprintf(expected, sizeof expected, "%" PRIu32, n);
+            if (!str_eq_cstr(fmt_u32(buf, n), expected)) {
+                test_fail("fmt_u32(%s) failed", expected);
+                ok = false;
+            }
+
+            snprintf(expected, sizeof expected, "%" PRIi32, (int32_t)n);
+            if (!str_eq_cstr(fmt_i32(buf, (int32_t)n), expected)) {
+                test_fail("fmt_i32(%s) failed", expected);
+                ok = false;
+            }
+
+            snprintf(expected, sizeof expected, "%" PRIx32, n);
+            if (!str_eq_cstr(fmt_x32(buf, n), expected)) {
+                test_fail("fmt_x32(%s) failed", expected);
+                ok = false;
+            }
+
+            bin_reference(expected, n);
+            if (!str_eq_cstr(fmt_b32(buf, n), expected)) {
+                test_fail("fmt_b32(%s) failed", expected);
+                ok = false;
+            }
+        }
+        if (ok) {
+            test_ok("32-bit conversions match snprintf()");
+        }
+    } while (0);
+
+    test_begin("64-bit conversions of edge values");
+    do {
+        bool ok = true;
+        for (size_t i = 0; ok && i < sizeof edge_values / sizeof *edge_values; i++) {
+            const uint64_t n = edge_values[i];
+
+            snprintf(expected, sizeof expected, "%" PRIu64, n);
+            if (!str_eq_cstr(fmt_u64(buf, n), expected)) {
+                test_fail("fmt_u64(%s) failed", expected);
+                ok = false;
+            }
+
+            snprintf(expected, sizeof expected, "%" PRIi64, (int64_t)n);
+            if (!str_eq_cstr(fmt_i64(buf, (int64_t)n), expected)) {
+                test_fail("fmt_i64(%s) failed", expected);
+                ok = false;
+            }
+
+            snprintf(expected, sizeof expected, "%" PRIx64, n);
+            if (!str_eq_cstr(fmt_x64(buf, n), expected)) {
+                test_fail("fmt_x64(%s) failed", expected);
+                ok = false;
+            }
+
+            bin_reference(expected, n);
+            if (!str_eq_cstr(fmt_b64(buf, n), expected)) {
+                test_fail("fmt_b64(%s) failed", expected);
+                ok = false;
+            }
+        }
+        if (ok) {
+            test_ok("64-bit conversions match snprintf()");
+        }
+    } while (0);
+
+    test_begin("random 64-bit conversions");
+    do {
+        bool ok = true;
+        for (size_t i = 0; ok && i < random_rounds; i++) {
+            const uint64_t n = rng_value();
+
+            snprintf(expected, sizeof expected, "%" PRIu64, n);
+            if (!str_eq_cstr(fmt_u64(buf, n), expected)) {
+                test_fail("fmt_u64(%s) failed", expected);
+                ok = false;
+            }
+
+            snprintf(expected, sizeof expected, "%" PRIi64, (int64_t)n);
+            if (!str_eq_cstr(fmt_i64(buf, (int64_t)n), expected)) {
+                test_fail("fmt_i64(%s) failed", expected);
+                ok = false;
+            }
+
+            snprintf(expected, sizeof expected, "%" PRIx64, n);
+            if (!str_eq_cstr(fmt_x64(buf, n), expected)) {
+                test_fail("fmt_x64(%s) failed", expected);
+                ok = false;
+            }
+        }
+        if (ok) {
+            test_ok("%zu random values match snprintf()", random_rounds);
+        }
+    } while (0);
+
+    test_begin("digits end at the end of the buffer");
+    do {
+        const struct str dec = fmt_u64(buf, UINT64_MAX);
+        if (dec.data + dec.len != buf + FMT_BUF_MAX) {
+            test_fail("digits are not right-aligned");
+            break;
+        }
+        const struct str bin = fmt_b64(buf, UINT64_MAX);
+        if (bin.len != 64 || bin.data != buf) {
+            test_fail("fmt_b64(UINT64_MAX) should fill the whole buffer");
+            break;
+        }
+        test_ok("digits are right-aligned");
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}
@@ -0,0 +1,321 @@
+#include "hashmap.h"
+
+static constexpr uint8_t CTRL_EMPTY   = 0x80; /* 0b10000000 */
+static constexpr uint8_t CTRL_DELETED = 0xFE; /* 0b11111110 */
+/* full slots hold the low 7 bits of the hash, 0b0hhhhhhh */
+
+/*
+ * Control byte groups
+ * ===================
+ * The ctrl array has HASHMAP_GROUP extra bytes at the end mirroring the first
+ * ones, so a group starting at any slot can be loaded without wrapping.
+ */
+static constexpr uint64_t ONES  = 0x0101010101010101;
+static constexpr uint64_t HIGHS = 0x8080808080808080;
+
+static inline uint64_t group_load(const uint8_t* ctrl)
+{
+    uint64_t g;
+    __builtin_memcpy(&g, ctrl, sizeof g);
+    return g;
+}
+
+/* bytes equal to h2. Can have false positives above a real match, which
+ * callers filter out by checking the control byte again */
+static inline uint64_t group_match(uint64_t g, uint8_t h2)
+{
+    const uint64_t x = g ^ (ONES * h2);
+    return (x - ONES) & ~x & HIGHS;
+}
+
+/* EMPTY is the only value with bit 7 set and bit 1 clear */
+static inline uint64_t group_match_empty(uint64_t g)
+{
+    return g & ~(g << 6) & HIGHS;
+}
+
+static inline uint64_t group_match_empty_or_deleted(uint64_t g)
+{
+    return g & HIGHS;
+}
+
+static inline size_t group_first(uint64_t mask)
+{
+    return __builtin_ctzll(mask) / 8;
+}
+
+static inline bool ctrl_is_full(uint8_t c)
+{
+    return !(c & 0x80);
+}
+
+static inline uint32_t key_hash(const struct hashmap* m, uintptr_t key)
+{
+    return m->ops->hash ? m->ops->hash(key) : hashmap_hash_int(key);
+}
+
+static inline bool key_eq(const struct hashmap* m, uintptr_t a, uintptr_t b)
+{
+    return m->ops->eq ? m->ops->eq(a, b) : a == b;
+}
+
+static inline uint8_t h2(uint32_t hash)
+{
+    return hash & 0x7f;
+}
+
+static inline size_t h1(uint32_t hash)
+{
+    return hash >> 7;
+}
+
+static inline void set_ctrl(struct hashmap_table* t, size_t i, uint8_t c)
+{
+    t->ctrl[i] = c;
+    if (i < HASHMAP_GROUP) {
+        t->ctrl[t->capacity + i] = c;
+    }
+}
+
+/*
+ * Tables
+ * ======
+ * One allocation holds the control bytes followed by the slots. Groups are
+ * probed with triangular strides, which visits every group of a power of two
+ * sized table.
+ */
+static int table_alloc(const struct hashmap* m, struct hashmap_table* t, size_t capacity)
+{
+    constexpr size_t align = alignof(struct hashmap_slot);
+    const size_t ctrl_size = (capacity + HASHMAP_GROUP + align - 1) / align * align;
+
+    uint8_t* mem = m->ops->alloc(ctrl_size + capacity * sizeof(struct hashmap_slot));
+    if (mem == NULL) {
+        return -1;
+    }
+
+    /* the only O(capacity) work of a resize, one byte per slot */
+    __builtin_memset(mem, CTRL_EMPTY, capacity + HASHMAP_GROUP);
+
+    *t = (struct hashmap_table){
+        .ctrl = mem,
+        .slots = (struct hashmap_slot*)(mem + ctrl_size),
+        .capacity = capacity,
+    };
+    return 0;
+}
+
+static void table_free(const struct hashmap* m, struct hashmap_table* t)
+{
+    if (t->ctrl != NULL) {
+        m->ops->free(t->ctrl);
+    }
+    *t = (struct hashmap_table){0};
+}
+
+static ptrdiff_t table_find(const struct hashmap* m, const struct hashmap_table* t,
+                            uintptr_t key, uint32_t hash)
+{
+    if (t->capacity == 0) {
+        return -1;
+    }
+
+    const size_t mask = t->capacity - 1;
+    size_t pos = h1(hash) & mask;
+
+    for (size_t stride = HASHMAP_GROUP;; stride += HASHMAP_GROUP) {
+        const uint64_t g = group_load(t->ctrl + pos);
+
+        for (uint64_t match = group_match(g, h2(hash)); match; match &= match - 1) {
+            const size_t i = (pos + group_first(match)) & mask;
+            if (t->ctrl[i] == h2(hash) && key_eq(m, t->slots[i].key, key)) {
+                return i;
+            }
+        }
+
+        /* the key would have been placed in this group */
+        if (group_match_empty(g)) {
+            return -1;
+        }
+
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* the table must not contain `key` and must have a free slot */
+static void table_insert_unique(struct hashmap_table* t, uintptr_t key, void* value, uint32_t hash)
+{
+    const size_t mask = t->capacity - 1;
+    size_t pos = h1(hash) & mask;
+
+    for (size_t stride = HASHMAP_GROUP;; stride += HASHMAP_GROUP) {
+        const uint64_t avail = group_match_empty_or_deleted(group_load(t->ctrl + pos));
+        if (avail) {
+            const size_t i = (pos + group_first(avail)) & mask;
+            if (t->ctrl[i] == CTRL_DELETED) {
+                t->tombstones -= 1;
+            }
+            set_ctrl(t, i, h2(hash));
+            t->slots[i] = (struct hashmap_slot){.key = key, .value = value};
+            t->count += 1;
+            return;
+        }
+        pos = (pos + stride) & mask;
+    }
+}
+
+static void table_erase(struct hashmap_table* t, size_t i)
+{
+    set_ctrl(t, i, CTRL_DELETED);
+    t->count -= 1;
+    t->tombstones += 1;
+}
+
+/*
+ * Incremental migration
+ * =====================
+ */
+static void migrate_step(struct hashmap* m)
+{
+    struct hashmap_table* old = &m->old;
+    size_t end = m->migrated + HASHMAP_MIGRATE_STEP;
+    if (end > old->capacity) {
+        end = old->capacity;
+    }
+
+    for (size_t i = m->migrated; i < end; i++) {
+        if (ctrl_is_full(old->ctrl[i])) {
+            const struct hashmap_slot s = old->slots[i];
+            table_insert_unique(&m->cur, s.key, s.value, key_hash(m, s.key));
+            /* so lookups in old can't find the moved entry */
+            table_erase(old, i);
+        }
+    }
+
+    m->migrated = end;
+    if (m->migrated == old->capacity) {
+        table_free(m, old);
+        m->migrated = 0;
+    }
+}
+
+/* makes room for one more entry in cur */
+static int reserve_one(struct hashmap* m)
+{
+    struct hashmap_table* cur = &m->cur;
+    if (cur->capacity != 0
+     && cur->count + cur->tombstones + 1 <= cur->capacity / 8 * 7)
+    {
+        return 0;
+    }
+
+    /* With a 2x growth and HASHMAP_MIGRATE_STEP slots moved per operation
+     * the previous migration always finishes before cur fills up again,
+     * this is just a safety net */
+    while (m->old.ctrl != NULL) {
+        migrate_step(m);
+    }
+
+    size_t capacity = HASHMAP_MIN_CAPACITY;
+    if (cur->capacity != 0) {
+        /* mostly tombstones: rehash at the same size */
+        capacity = cur->count >= cur->capacity / 2 ? cur->capacity * 2 : cur->capacity;
+    }
+
+    struct hashmap_table fresh;
+    if (table_alloc(m, &fresh, capacity) < 0) {
+        return -1;
+    }
+
+    if (cur->capacity != 0) {
+        m->old = *cur;
+        m->migrated = 0;
+    }
+    *cur = fresh;
+    return 0;
+}
+
+int hashmap_insert(struct hashmap* m, uintptr_t key, void* value)
+{
+    const uint32_t hash = key_hash(m, key);
+
+    if (m->old.ctrl != NULL) {
+        migrate_step(m);
+    }
+
+    ptrdiff_t i = table_find(m, &m->cur, key, hash);
+    if (i >= 0) {
+        m->cur.slots[i].value = value;
+        return 0;
+    }
+
+    /* an entry that hasn't been migrated yet is updated in place */
+    i = table_find(m, &m->old, key, hash);
+    if (i >= 0) {
+        m->old.slots[i].value = value;
+        return 0;
+    }
+
+    if (reserve_one(m) < 0) {
+        return -1;
+    }
+    table_insert_unique(&m->cur, key, value, hash);
+    return 0;
+}
+
+bool hashmap_get(const struct hashmap* m, uintptr_t key, void** out)
+{
+    const uint32_t hash = key_hash(m, key);
+
+    const struct hashmap_table* t = &m->cur;
+    ptrdiff_t i = table_find(m, t, key, hash);
+    if (i < 0) {
+        t = &m->old;
+        i = table_find(m, t, key, hash);
+    }
+    if (i < 0) {
+        return false;
+    }
+
+    if (out != NULL) {
+        *out = t->slots[i].value;
+    }
+    return true;
+}
+
+bool hashmap_remove(struct hashmap* m, uintptr_t key, void** out)
+{
+    const uint32_t hash = key_hash(m, key);
+
+    if (m->old.ctrl != NULL) {
+        migrate_step(m);
+    }
+
+    struct hashmap_table* t = &m->cur;
+    ptrdiff_t i = table_find(m, t, key, hash);
+    if (i < 0) {
+        t = &m->old;
+        i = table_find(m, t, key, hash);
+    }
+    if (i < 0) {
+        return false;
+    }
+
+    if (out != NULL) {
+        *out = t->slots[i].value;
+    }
+    table_erase(t, i);
+    return true;
+}
+
+size_t hashmap_count(const struct hashmap* m)
+{
+    return m->cur.count + m->old.count;
+}
+
+void hashmap_clear(struct hashmap* m)
+{
+    table_free(m, &m->cur);
+    table_free(m, &m->old);
+    m->migrated = 0;
+}
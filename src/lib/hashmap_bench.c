@@ -0,0 +1,82 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "hashmap.h"
+
+/*
+ * Compares hashmap lookups with a linear search over an array of key/value
+ * pairs, the way kernel tables are searched today, at growing sizes.
+ */
+
+static constexpr size_t LOOKUPS = 4096;
+
+static const struct hashmap_ops int_ops = {
+    .alloc = malloc,
+    .free = free,
+};
+
+__attribute__((noipa))
+static void* linear_get(const struct hashmap_slot* slots, size_t count, uintptr_t key)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (slots[i].key == key) {
+            return slots[i].value;
+        }
+    }
+    return NULL;
+}
+
+static uintptr_t key_of(size_t i)
+{
+    /* sparse keys, like pids or addresses */
+    return (uintptr_t)i * 2654435761u + 1;
+}
+
+/* the i-th key looked up, spread over the whole map */
+static uintptr_t probe(size_t i, size_t count)
+{
+    return key_of((i * 7919 + 12345) % count);
+}
+
+static void* get(const struct hashmap* m, uintptr_t key)
+{
+    void* v = NULL;
+    hashmap_get(m, key, &v);
+    return v;
+}
+
+static void bench_size(size_t count)
+{
+    struct hashmap m = HASHMAP_INIT(&int_ops);
+    struct hashmap_slot* slots = malloc(count * sizeof *slots);
+    char name[64];
+
+    for (size_t i = 0; i < count; i++) {
+        slots[i] = (struct hashmap_slot){.key = key_of(i), .value = (void*)i};
+    }
+
+    snprintf(name, sizeof name, "insert/%zu", count);
+    BENCH_RESET(name, hashmap_clear(&m), i, count, hashmap_insert(&m, key_of(i), (void*)i));
+
+    snprintf(name, sizeof name, "get/%zu", count);
+    BENCH(name, i, LOOKUPS, get(&m, probe(i, count)));
+
+    snprintf(name, sizeof name, "get_miss/%zu", count);
+    BENCH(name, i, LOOKUPS, hashmap_get(&m, key_of(count + i), NULL));
+
+    /* linear search is quadratic overall, keep the rounds short */
+    snprintf(name, sizeof name, "linear_get/%zu", count);
+    BENCH(name, i, LOOKUPS / count + 8, linear_get(slots, count, probe(i, count)));
+
+    hashmap_clear(&m);
+    free(slots);
+}
+
+int main()
+{
+    bench_size(100);
+    bench_size(1000);
+    bench_size(10000);
+    bench_size(100000);
+    return EXIT_SUCCESS;
+}
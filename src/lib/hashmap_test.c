@@ -0,0 +1,246 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include "hashmap.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+static const struct hashmap_ops int_ops = {
+    .alloc = malloc,
+    .free = free,
+};
+
+/* keys are pointers to NUL terminated strings */
+static uint32_t cstr_hash(uintptr_t key)
+{
+    uint32_t h = 0x811c9dc5;
+    for (const char* p = (const char*)key; *p; p++) {
+        h ^= (uint8_t)*p;
+        h *= 0x01000193;
+    }
+    return h;
+}
+
+static bool cstr_eq(uintptr_t a, uintptr_t b)
+{
+    return strcmp((const char*)a, (const char*)b) == 0;
+}
+
+static const struct hashmap_ops cstr_ops = {
+    .hash = cstr_hash,
+    .eq = cstr_eq,
+    .alloc = malloc,
+    .free = free,
+};
+
+int main()
+{
+    test_begin("empty map");
+    do {
+        struct hashmap m = HASHMAP_INIT(&int_ops);
+        if (hashmap_get(&m, 42, NULL) || hashmap_remove(&m, 42, NULL) || hashmap_count(&m) != 0) {
+            test_fail("empty map should contain nothing");
+            break;
+        }
+        test_ok("empty map contains nothing");
+    } while (0);
+
+    test_begin("insert, replace and get");
+    do {
+        struct hashmap m = HASHMAP_INIT(&int_ops);
+        bool ok = true;
+        for (uintptr_t k = 0; k < 1000; k++) {
+            if (hashmap_insert(&m, k, (void*)(k * 3)) != 0) {
+                test_fail("insert %zu failed", (size_t)k);
+                ok = false;
+                break;
+            }
+        }
+        for (uintptr_t k = 0; ok && k < 1000; k += 2) {
+            hashmap_insert(&m, k, (void*)(k * 5));
+        }
+        for (uintptr_t k = 0; ok && k < 1000; k++) {
+            void* v = NULL;
+            if (!hashmap_get(&m, k, &v) || v != (void*)(k * (k % 2 ? 3 : 5))) {
+                test_fail("key %zu has the wrong value", (size_t)k);
+                ok = false;
+            }
+        }
+        if (ok && hashmap_count(&m) != 1000) {
+            test_fail("count is %zu, expected 1000", hashmap_count(&m));
+            ok = false;
+        }
+        if (ok) {
+            test_ok("1000 keys inserted, half of them replaced");
+        }
+        hashmap_clear(&m);
+    } while (0);
+
+    test_begin("randomized against a reference array");
+    do {
+        constexpr size_t key_space = 4096;
+        constexpr size_t rounds = 500000;
+        static bool present[key_space];
+        static uintptr_t values[key_space];
+        size_t expected_count = 0;
+        struct hashmap m = HASHMAP_INIT(&int_ops);
+        bool ok = true;
+
+        srand(7);
+        for (size_t r = 0; ok && r < rounds; r++) {
+            /* spread keys out so they don't hash to neighbouring slots */
+            const size_t i = rand() % key_space;
+            const uintptr_t key = (uintptr_t)i * 0x10001;
+            const uintptr_t value = rand();
+            void* got = NULL;
+
+            switch (rand() % 3) {
+            case 0:
+                hashmap_insert(&m, key, (void*)value);
+                expected_count += !present[i];
+                present[i] = true;
+                values[i] = value;
+                break;
+            case 1:
+                if (hashmap_remove(&m, key, &got) != present[i]
+                 || (present[i] && got != (void*)values[i]))
+                {
+                    test_fail("remove of key %zu disagrees with the reference", i);
+                    ok = false;
+                }
+                expected_count -= present[i];
+                present[i] = false;
+                break;
+            case 2:
+                if (hashmap_get(&m, key, &got) != present[i]
+                 || (present[i] && got != (void*)values[i]))
+                {
+                    test_fail("get of key %zu disagrees with the reference", i);
+                    ok = false;
+                }
+                break;
+            }
+
+            if (hashmap_count(&m) != expected_count) {
+                test_fail("count is %zu, expected %zu", hashmap_count(&m), expected_count);
+                ok = false;
+            }
+        }
+        if (ok) {
+            test_ok("%zu random operations matched the reference", rounds);
+        }
+        hashmap_clear(&m);
+    } while (0);
+
+    test_begin("growth is incremental");
+    do {
+        struct hashmap m = HASHMAP_INIT(&int_ops);
+        size_t migrating_inserts = 0;
+        size_t max_old_capacity = 0;
+        bool ok = true;
+
+        for (uintptr_t k = 0; k < 100000; k++) {
+            hashmap_insert(&m, k, (void*)k);
+            if (m.old.ctrl != NULL) {
+                migrating_inserts += 1;
+                if (m.old.capacity > max_old_capacity) {
+                    max_old_capacity = m.old.capacity;
+                }
+            }
+        }
+        /* every entry must still be reachable at the end */
+        for (uintptr_t k = 0; k < 100000; k++) {
+            void* v;
+            if (!hashmap_get(&m, k, &v) || v != (void*)k) {
+                test_fail("key %zu lost during growth", (size_t)k);
+                ok = false;
+                break;
+            }
+        }
+        if (ok && migrating_inserts == 0) {
+            test_fail("no insert happened while a migration was in progress");
+            ok = false;
+        }
+        if (ok) {
+            test_ok("%zu inserts ran during migrations (largest old table %zu slots)",
+                    migrating_inserts, max_old_capacity);
+        }
+        hashmap_clear(&m);
+    } while (0);
+
+    test_begin("custom hash and eq");
+    do {
+        struct hashmap m = HASHMAP_INIT(&cstr_ops);
+        const char* paths[] = {"/", "/bin", "/bin/sh", "/usr", "/usr/bin", "/etc/passwd"};
+        constexpr size_t n = sizeof paths / sizeof *paths;
+        char copy[32];
+        bool ok = true;
+
+        for (size_t i = 0; i < n; i++) {
+            hashmap_insert(&m, (uintptr_t)paths[i], (void*)(i + 1));
+        }
+        for (size_t i = 0; i < n; i++) {
+            /* look up through a different pointer to the same contents */
+            strcpy(copy, paths[i]);
+            void* v;
+            if (!hashmap_get(&m, (uintptr_t)copy, &v) || v != (void*)(i + 1)) {
+                test_fail("lookup of \"%s\" failed", paths[i]);
+                ok = false;
+            }
+        }
+        if (ok && hashmap_get(&m, (uintptr_t)"/nonexistent", NULL)) {
+            test_fail("found a key that was never inserted");
+            ok = false;
+        }
+        if (ok) {
+            test_ok("string keys found by contents");
+        }
+        hashmap_clear(&m);
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}
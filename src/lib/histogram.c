@@ -0,0 +1,31 @@
+#include "histogram.h"
+
+uint64_t histogram_bucket_max(size_t bucket)
+{
+    if (bucket >= HISTOGRAM_BUCKETS - 1) {
+        return UINT64_MAX;
+    }
+    return (UINT64_C(1) << bucket) - 1;
+}
+
+uint64_t histogram_quantile(const struct histogram* h, uint32_t permille)
+{
+    if (h->count == 0) {
+        return 0;
+    }
+
+    /* nearest rank, at least the first value */
+    uint64_t rank = (h->count * permille + 999) / 1000;
+    rank = rank == 0 ? 1 : rank;
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            const uint64_t end = histogram_bucket_max(b);
+            return end < h->max ? end : h->max;
+        }
+    }
+    /* the buckets wrapped around */
+    return h->max;
+}
@@ -0,0 +1,128 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include "histogram.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+int main()
+{
+    test_begin("values land in the bucket of their bit length");
+    do {
+        static const struct {
+            uint64_t value;
+            size_t   bucket;
+        } cases[] = {
+            {0, 0}, {1, 1}, {2, 2}, {3, 2}, {4, 3}, {255, 8}, {256, 9},
+            {(1 << 22) - 1, 22}, {1 << 22, 23}, {UINT64_MAX, HISTOGRAM_BUCKETS - 1},
+        };
+        size_t errors = 0;
+        for (size_t i = 0; i < sizeof cases / sizeof *cases; i++) {
+            const size_t b = histogram_bucket(cases[i].value);
+            if (b != cases[i].bucket) {
+                printf("%llu: bucket %zu, expected %zu\n",
+                       (unsigned long long)cases[i].value, b, cases[i].bucket);
+                errors++;
+            }
+            if (b + 1 < HISTOGRAM_BUCKETS && cases[i].value > histogram_bucket_max(b)) {
+                printf("%llu: above the end of bucket %zu\n", (unsigned long long)cases[i].value, b);
+                errors++;
+            }
+        }
+        if (errors != 0) {
+            test_fail("%zu values in the wrong bucket", errors);
+        } else {
+            test_ok("%zu values", sizeof cases / sizeof *cases);
+        }
+    } while (0);
+
+    test_begin("quantiles are bucket ends capped at the maximum");
+    do {
+        struct histogram h = {0};
+        if (histogram_quantile(&h, 500) != 0) {
+            test_fail("empty histogram");
+            break;
+        }
+        /* 90 values around 100 (bucket 7) and 10 around 5000 (bucket 13) */
+        for (size_t i = 0; i < 90; i++) {
+            histogram_add(&h, 100 + i % 20);
+        }
+        for (size_t i = 0; i < 10; i++) {
+            histogram_add(&h, 5000 + i);
+        }
+        const uint64_t p0 = histogram_quantile(&h, 0);
+        const uint64_t p50 = histogram_quantile(&h, 500);
+        const uint64_t p90 = histogram_quantile(&h, 900);
+        const uint64_t p91 = histogram_quantile(&h, 910);
+        const uint64_t p100 = histogram_quantile(&h, 1000);
+        if (h.count != 100 || h.max != 5009 || p0 != 127 || p50 != 127
+         || p90 != 127 || p91 != 5009 || p100 != 5009)
+        {
+            test_fail("count %llu, max %llu, quantiles %llu %llu %llu %llu %llu",
+                      (unsigned long long)h.count, (unsigned long long)h.max,
+                      (unsigned long long)p0, (unsigned long long)p50, (unsigned long long)p90,
+                      (unsigned long long)p91, (unsigned long long)p100);
+        } else {
+            test_ok("p50 %llu, p91 %llu", (unsigned long long)p50, (unsigned long long)p91);
+        }
+    } while (0);
+
+    test_begin("huge values share the last bucket and keep their maximum");
+    do {
+        struct histogram h = {0};
+        histogram_add(&h, 1ULL << 40);
+        histogram_add(&h, 1ULL << 30);
+        const uint64_t p100 = histogram_quantile(&h, 1000);
+        if (h.buckets[HISTOGRAM_BUCKETS - 1] != 2 || p100 != 1ULL << 40) {
+            test_fail("last bucket %u, p100 %llu", h.buckets[HISTOGRAM_BUCKETS - 1],
+                      (unsigned long long)p100);
+        } else {
+            test_ok("p100 %llu", (unsigned long long)p100);
+        }
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}
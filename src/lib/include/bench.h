@@ -0,0 +1,88 @@
+#pragma once
+
+/*
+ * Host benchmark harness
+ * ======================
+ * Shared by the src/lib/X_bench.c programs `make bench` builds and runs
+ * natively. Never included by the kernel.
+ *
+ * Every benchmark runs BENCH_WARMUP untimed rounds followed by BENCH_RUNS
+ * timed ones and prints one JSON object per line:
+ *
+ *   {"suite":"str","name":"str_find/65536","median_ns":812.4,"p99_ns":901.2,"runs":101}
+ *
+ * with the median and 99th percentile of the per-operation time over the
+ * timed rounds.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static constexpr size_t BENCH_WARMUP = 10;
+static constexpr size_t BENCH_RUNS = 101;
+
+/* results are accumulated here so the compiler can't drop the work */
+static volatile size_t bench_sink;
+
+static inline double bench_now_ns(void)
+{
+    /* POSIX, BENCH_CFLAGS defines _POSIX_C_SOURCE for -std=c2x */
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline int bench_compare(const void* a, const void* b)
+{
+    const double x = *(const double*)a;
+    const double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* `file` is __FILE__ of the benchmark, its basename without "_bench.c" is
+ * the suite name */
+static inline void bench_report(const char* file, const char* name, double* samples, size_t runs)
+{
+    const char* base = strrchr(file, '/');
+    base = base != NULL ? base + 1 : file;
+    const char* suffix = strstr(base, "_bench.c");
+    const int base_len = suffix != NULL ? (int)(suffix - base) : (int)strlen(base);
+
+    qsort(samples, runs, sizeof *samples, bench_compare);
+    /* nearest rank */
+    const size_t p99 = (runs * 99 + 99) / 100 - 1;
+
+    /* fprintf, the printf benchmark links a different printf() */
+    fprintf(stdout, "{\"suite\":\"%.*s\",\"name\":\"%s\",\"median_ns\":%.2f,\"p99_ns\":%.2f,\"runs\":%zu}\n",
+            base_len, base, name, samples[runs / 2], samples[p99], runs);
+}
+
+/*
+ * Times `ops` evaluations of `expr` with `i` counting from 0 per round,
+ * `reset` runs untimed before every round.
+ */
+#define BENCH_RESET(name, reset, i, ops, expr)                                  \
+    do {                                                                        \
+        double bench_samples_[BENCH_RUNS];                                      \
+        size_t bench_acc_ = 0;                                                  \
+        const size_t bench_ops_ = (ops);                                        \
+        for (size_t bench_run_ = 0; bench_run_ < BENCH_WARMUP + BENCH_RUNS; bench_run_++) { \
+            reset;                                                              \
+            const double bench_begin_ = bench_now_ns();                         \
+            for (size_t i = 0; i < bench_ops_; i++) {                           \
+                bench_acc_ += (size_t)(expr);                                   \
+            }                                                                   \
+            const double bench_end_ = bench_now_ns();                           \
+            if (bench_run_ >= BENCH_WARMUP) {                                   \
+                bench_samples_[bench_run_ - BENCH_WARMUP] =                     \
+                    (bench_end_ - bench_begin_) / bench_ops_;                   \
+            }                                                                   \
+        }                                                                       \
+        bench_sink = bench_acc_;                                                \
+        bench_report(__FILE__, name, bench_samples_, BENCH_RUNS);              \
+    } while (0)
+
+#define BENCH(name, i, ops, expr) BENCH_RESET(name, (void)0, i, ops, expr)
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "str.h"
+
+/*
+ * Integer to text conversion
+ * ==========================
+ * Every function writes its digits right-aligned into the end of `buf` and
+ * returns a str pointing at them. The str is only valid as long as `buf` is.
+ *
+ * Decimal conversion emits two digits per step from a lookup table. 64-bit
+ * values are split into base 10^9 chunks with a multiply-by-reciprocal, so
+ * no 64-bit division (libgcc's __udivdi3 on i686) is ever generated.
+ * Hexadecimal and binary conversion only shift and mask.
+ */
+
+/* large enough for a 64-bit number in binary */
+constexpr size_t FMT_BUF_MAX = 64;
+
+struct str fmt_u32(char buf[static FMT_BUF_MAX], uint32_t n);
+struct str fmt_i32(char buf[static FMT_BUF_MAX], int32_t n);
+struct str fmt_x32(char buf[static FMT_BUF_MAX], uint32_t n);
+struct str fmt_b32(char buf[static FMT_BUF_MAX], uint32_t n);
+
+struct str fmt_u64(char buf[static FMT_BUF_MAX], uint64_t n);
+struct str fmt_i64(char buf[static FMT_BUF_MAX], int64_t n);
+struct str fmt_x64(char buf[static FMT_BUF_MAX], uint64_t n);
+struct str fmt_b64(char buf[static FMT_BUF_MAX], uint64_t n);
+
+/* floor(n / 10^9) without a 64-bit division, exposed for tests */
+uint64_t fmt_div_1e9(uint64_t n);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Open addressing hash map
+ * ========================
+ * Maps uintptr_t keys to void* values. Integer keys (pids, irq lines, ...)
+ * work out of the box, other keys are stored as pointers with a custom
+ * hash and eq in hashmap_ops.
+ *
+ * The layout follows SwissTable: every slot has one control byte holding
+ * either EMPTY, DELETED or the low 7 bits of the key's hash. A probe loads
+ * a group of 8 control bytes as one 64-bit word and finds candidate slots
+ * with SWAR byte matching, so most lookups touch a single key.
+ *
+ * Growing is incremental. When the table is 7/8 full a table of twice the
+ * size is allocated and every following insert or remove moves at most
+ * HASHMAP_MIGRATE_STEP slots over, so no single insert rehashes the whole
+ * map. Lookups check both tables while a migration is in progress.
+ */
+
+constexpr size_t HASHMAP_GROUP = 8;
+constexpr size_t HASHMAP_MIN_CAPACITY = 16;
+constexpr size_t HASHMAP_MIGRATE_STEP = 16;
+
+struct hashmap_ops {
+    /* NULL: keys are integers hashed with hashmap_hash_int() and compared
+     * with == */
+    uint32_t (*hash)(uintptr_t key);
+    bool     (*eq)(uintptr_t a, uintptr_t b);
+
+    /* memory for the tables */
+    void*    (*alloc)(size_t size);
+    void     (*free)(void* ptr);
+};
+
+struct hashmap_slot {
+    uintptr_t key;
+    void*     value;
+};
+
+struct hashmap_table {
+    uint8_t*             ctrl;  /* capacity + HASHMAP_GROUP bytes */
+    struct hashmap_slot* slots;
+    size_t               capacity;
+    size_t               count;
+    size_t               tombstones;
+};
+
+struct hashmap {
+    const struct hashmap_ops* ops;
+    struct hashmap_table      cur;
+    struct hashmap_table      old;      /* being drained into cur if old.ctrl != NULL */
+    size_t                    migrated; /* slots of old that have been moved */
+};
+
+#define HASHMAP_INIT(operations) (struct hashmap){.ops = operations}
+
+/* Fast 32-bit integer mix, the finalizer of MurmurHash3 */
+static inline uint32_t hashmap_hash_int(uintptr_t key)
+{
+    uint32_t h = (uint32_t)key ^ (uint32_t)((uint64_t)key >> 32);
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
+
+/* Inserts or replaces `key`. Returns 0 on success, -1 if memory could not be
+ * allocated */
+int hashmap_insert(struct hashmap* m, uintptr_t key, void* value);
+
+/* Returns true and stores the value in `out` (if not NULL) if `key` exists */
+bool hashmap_get(const struct hashmap* m, uintptr_t key, void** out);
+
+/* Returns true and stores the removed value in `out` (if not NULL) if `key`
+ * existed */
+bool hashmap_remove(struct hashmap* m, uintptr_t key, void** out);
+
+size_t hashmap_count(const struct hashmap* m);
+
+/* Frees the tables, the map can be reused afterwards */
+void hashmap_clear(struct hashmap* m);
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Log2 histogram
+ * ==============
+ * Counts values by their bit length: bucket 0 holds 0 and bucket b holds
+ * 2^(b-1) to 2^b - 1. The last bucket also takes everything larger, the
+ * exact maximum is kept on the side. Adding a value is a bit scan and two
+ * increments, cheap enough for interrupt entry and exit.
+ *
+ * The buckets only give the order of magnitude, so quantiles come out as
+ * the upper end of the bucket they fall into.
+ */
+constexpr size_t HISTOGRAM_BUCKETS = 24;
+
+struct histogram {
+    uint64_t count;
+    uint64_t max;
+    uint32_t buckets[HISTOGRAM_BUCKETS];
+};
+
+static inline size_t histogram_bucket(uint64_t value)
+{
+    const size_t bits = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    return bits < HISTOGRAM_BUCKETS ? bits : HISTOGRAM_BUCKETS - 1;
+}
+
+static inline void histogram_add(struct histogram* h, uint64_t value)
+{
+    h->count += 1;
+    h->max = value > h->max ? value : h->max;
+    h->buckets[histogram_bucket(value)] += 1;
+}
+
+/* largest value that goes into `bucket`, UINT64_MAX for the last */
+uint64_t histogram_bucket_max(size_t bucket);
+
+/* Returns an upper bound of the value `permille` thousandths of the values
+ * are at or below, the end of its bucket but at most h->max. 0 for an empty
+ * histogram */
+uint64_t histogram_quantile(const struct histogram* h, uint32_t permille);
@@ -1,9 +1,10 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 struct str {
-    const char*  data; 
+    const char*  data;
     const size_t len;
 };
 
@@ -19,3 +20,53 @@ static inline struct str str_slice(struct str s, size_t begin, size_t end)
 
 #define CSTR_(x) #x
 #define CSTR(x) CSTR_(x)
+
+/*
+ * String routines
+ * ===============
+ * These compare and search a machine word at a time (see str.c) and never
+ * read outside of [data, data+len).
+ */
+bool str_eq(struct str a, struct str b);
+
+/* lexicographic byte comparison, returns -1, 0 or 1 */
+int str_cmp(struct str a, struct str b);
+
+/* returns the index of the first `c` in `s`, or -1 */
+ptrdiff_t str_find_byte(struct str s, char c);
+
+/* returns the index of the first occurrence of `needle`, or -1 */
+ptrdiff_t str_find(struct str haystack, struct str needle);
+
+/*
+ * Splitting
+ * =========
+ * struct str_split it = str_split(str_attach("usr/bin/sh"), '/');
+ * for (;;) {
+ *     const struct str token = str_split_next(&it);
+ *     if (token.data == NULL)
+ *         break;
+ *     ...
+ * }
+ * Adjacent separators produce empty tokens, so "a//b" gives "a", "" and "b".
+ */
+struct str_split {
+    struct str s;
+    size_t     pos;
+    char       sep;
+};
+
+#define str_split(str, separator) (struct str_split){.s = str, .pos = 0, .sep = separator}
+
+/* returns the next token, or a str with data == NULL when there are none */
+struct str str_split_next(struct str_split* it);
+
+/* parse an unsigned decimal number. Returns false on an empty string, any
+ * non-digit character or overflow */
+bool str_to_u32(struct str s, uint32_t* out);
+
+/* like str_to_u32() but accepts a leading '-' or '+' */
+bool str_to_i32(struct str s, int32_t* out);
+
+/* 32-bit MurmurHash3 of the string contents */
+uint32_t str_hash(struct str s);
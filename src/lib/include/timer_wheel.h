@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Hierarchical timer wheel
+ * ========================
+ * Timers are kept in TIMER_WHEEL_LEVELS wheels of TIMER_WHEEL_SLOTS slots.
+ * Level 0 has one slot per tick for timers due within the next 64 ticks,
+ * each slot of level n covers 64^n ticks. A timer goes to the level its
+ * distance from `now` falls into and to the slot of its expiry time there,
+ * so adding one is a few shifts and a list insert.
+ *
+ * Every tick timer_wheel_advance() runs the level 0 slot of the new time.
+ * When the level 0 index wraps to 0 the next slot of level 1 is cascaded:
+ * its timers are added again and now land in level 0, and so on upwards.
+ * A timer is therefore moved at most TIMER_WHEEL_LEVELS - 1 times, and a
+ * tick without cascades only looks at one slot.
+ *
+ * Timers further out than the whole wheel (2^24 ticks) wait in the last
+ * slot of the top level and are added again when it comes round.
+ *
+ * The wheel doesn't allocate, callers embed struct timer. Slots are doubly
+ * linked through `pprev`, so cancelling is O(1) too.
+ *
+ * https://www.cs.columbia.edu/~nahum/w6998/papers/sosp87-timing-wheels.pdf
+ */
+constexpr size_t TIMER_WHEEL_BITS = 6;
+constexpr size_t TIMER_WHEEL_SLOTS = 1 << TIMER_WHEEL_BITS;
+constexpr size_t TIMER_WHEEL_LEVELS = 4;
+
+typedef void (*timer_fn_t)(void* ctx);
+
+struct timer {
+    struct timer*  next;
+    struct timer** pprev;   /* NULL while not pending */
+    uint64_t       expires; /* tick */
+    timer_fn_t     fn;
+    void*          ctx;
+};
+
+struct timer_wheel {
+    uint64_t      now;      /* last tick run */
+    size_t        pending;
+    struct timer* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+#define TIMER_WHEEL_INIT (struct timer_wheel){0}
+
+/* Runs fn(ctx) from timer_wheel_advance() at tick `expires`, or at the next
+ * tick if that has passed. `t` must not be pending */
+void timer_wheel_add(struct timer_wheel* w, struct timer* t, uint64_t expires,
+                     timer_fn_t fn, void* ctx);
+
+/* Returns false if `t` wasn't pending, it ran or was cancelled already */
+bool timer_wheel_cancel(struct timer_wheel* w, struct timer* t);
+
+static inline bool timer_pending(const struct timer* t)
+{
+    return t->pprev != NULL;
+}
+
+/* Returns the earliest expiry of all pending timers, UINT64_MAX if there
+ * are none. Looks at the first occupied slot of every level, so it costs up
+ * to TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOTS slot checks, meant for idle
+ * entry rather than every tick */
+uint64_t timer_wheel_next(const struct timer_wheel* w);
+
+/* Runs every tick up to and including `now`, returns the number of timers
+ * that ran. A timer is unlinked before it runs, so its function may add
+ * it again or cancel others */
+size_t timer_wheel_advance(struct timer_wheel* w, uint64_t now);
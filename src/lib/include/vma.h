@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Virtual memory areas
+ * ====================
+ * The mapped regions of an address space, kept in an intrusive red-black
+ * tree ordered by start address. Regions never overlap, so a plain search
+ * tree already answers "which region contains this address" in O(log n)
+ * without interval augmentation.
+ *
+ * The tree doesn't allocate: callers embed or allocate struct vma and hand
+ * it over, split takes the node for the upper half and merge hands back the
+ * node it unlinked.
+ *
+ * Page faults tend to hit the same region many times in a row (a stack
+ * growing, a file being read sequentially), so vma_find() checks the last
+ * region it returned before walking the tree.
+ */
+
+struct vma {
+    struct vma* parent;
+    struct vma* left;
+    struct vma* right;
+    bool        red;
+
+    uintptr_t   start; /* first address */
+    uintptr_t   end;   /* one past the last address */
+    uint32_t    flags; /* caller defined, only compared by vma_merge_next() */
+};
+
+struct vma_tree {
+    struct vma* root;
+    struct vma* last_hit;
+    size_t      count;
+};
+
+#define VMA_TREE_INIT (struct vma_tree){0}
+
+/* Returns the region containing `addr` or NULL */
+struct vma* vma_find(struct vma_tree* t, uintptr_t addr);
+
+/* Returns the first region ending after `addr` (containing it or above it),
+ * NULL if there is none */
+struct vma* vma_find_from(struct vma_tree* t, uintptr_t addr);
+
+/* Links `v` with v->start, v->end and v->flags set. Returns -1 if the range
+ * is empty or overlaps an existing region */
+int vma_insert(struct vma_tree* t, struct vma* v);
+
+/* Unlinks `v`, the caller owns it again */
+void vma_remove(struct vma_tree* t, struct vma* v);
+
+/* Shrinks `v` to [v->start, addr) and links `tail` as [addr, v->end) with the
+ * same flags. Returns -1 if `addr` isn't strictly inside `v` */
+int vma_split(struct vma_tree* t, struct vma* v, uintptr_t addr, struct vma* tail);
+
+/* If the region following `v` starts at v->end and has the same flags it is
+ * unlinked, `v` is extended over it and it is returned for the caller to free.
+ * Returns NULL otherwise */
+struct vma* vma_merge_next(struct vma_tree* t, struct vma* v);
+
+/* In-order iteration */
+struct vma* vma_first(struct vma_tree* t);
+struct vma* vma_next(struct vma* v);
+struct vma* vma_prev(struct vma* v);
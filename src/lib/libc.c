@@ -16,6 +16,7 @@ __attribute__((noreturn))
 void panic(struct str s)
 {
     //terminal_clear();
+    terminal_emergency();
     terminal_set_color(VGA_COLOR_WHITE, VGA_COLOR_RED);
     terminal_write(s);
     __asm__ volatile("cli; hlt");
@@ -0,0 +1,68 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "str.h"
+
+/*
+ * The freestanding mem*() functions from libc.c at sizes from a struct copy
+ * to a VGA screen scroll and beyond. They replace the C library's versions in
+ * this program, so <string.h> declarations call the kernel code.
+ */
+
+static constexpr size_t MAX = 64 * 1024;
+
+static uint8_t a[MAX + 64];
+static uint8_t b[MAX + 64];
+
+/* memcmp() is declared pure and would be hoisted out of the loop */
+static int (*volatile memcmp_opaque)(const void*, const void*, size_t) = memcmp;
+
+/* panic() needs these */
+void terminal_set_color(uint8_t fg, uint8_t bg)
+{
+    (void)fg;
+    (void)bg;
+}
+
+void terminal_write(struct str s)
+{
+    (void)s;
+}
+
+void terminal_emergency(void)
+{
+}
+
+static void bench_size(size_t n, size_t ops)
+{
+    char name[64];
+
+    snprintf(name, sizeof name, "memcpy/%zu", n);
+    BENCH(name, i, ops, memcpy(a, b, n));
+
+    snprintf(name, sizeof name, "memcpy_unaligned/%zu", n);
+    BENCH(name, i, ops, memcpy(a + 1, b + 3, n));
+
+    snprintf(name, sizeof name, "memset/%zu", n);
+    BENCH(name, i, ops, memset(a, (int)i, n));
+
+    /* overlapping, like terminal_scroll() */
+    snprintf(name, sizeof name, "memmove_down/%zu", n);
+    BENCH(name, i, ops, memmove(a, a + 32, n));
+
+    snprintf(name, sizeof name, "memmove_up/%zu", n);
+    BENCH(name, i, ops, memmove(a + 32, a, n));
+
+    memcpy(b, a, n);
+    snprintf(name, sizeof name, "memcmp_equal/%zu", n);
+    BENCH(name, i, ops, memcmp_opaque(a, b, n));
+}
+
+int main()
+{
+    bench_size(16,  4096);
+    bench_size(256, 4096);
+    bench_size(80 * 24 * sizeof(uint16_t), 1024);
+    bench_size(MAX, 64);
+    return EXIT_SUCCESS;
+}
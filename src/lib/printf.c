@@ -4,10 +4,9 @@
 #include <stdint.h>
 
 #include "libc.h"
+#include "fmt.h"
 #include "kernel/tty.h"
 
-typedef int (*printf_function)(struct printf_state* s, void* data);
-
 constexpr int EOF = -1;
 
 struct printf_state {
@@ -17,6 +16,8 @@ struct printf_state {
     int written;
 };
 
+typedef int (*printf_function)(struct printf_state* s, void* data);
+
 static inline int ps_peek(struct printf_state* s)
 {
     if (s->i == s->str.len) {
@@ -33,80 +34,83 @@ static inline int ps_get(struct printf_state* s)
     return s->str.data[s->i++];
 }
 
-static int print_long(unsigned long n, struct str alphabet, bool is_signed, unsigned int padding, char pad_char)
+/* prints `digits` left-padded to `padding` characters with `pad_char`, a
+ * leading '-' is kept in front of the padding */
+static int print_digits(struct str digits, unsigned int padding, char pad_char)
 {
-    constexpr size_t BUF_SZ = 128;
-    char buf[BUF_SZ];
-    size_t i = 0;
-
-    if (padding > BUF_SZ) {
-        return -1;
-    }
-
-    if (n == 0) {
-        terminal_putchar('0');
-        return 1;
-    }
+    const bool is_negative = digits.len != 0 && digits.data[0] == '-';
+    const struct str magnitude = str_slice(digits, is_negative, 0);
+    size_t written = digits.len;
 
-    bool is_negative = false;
-    if (is_signed) {
-        signed long signed_n = (signed long)n;
-        if (signed_n < 0) {
-            is_negative = true;
-            n = -signed_n;
-        }
-    }
-
-    if (is_negative)
+    if (is_negative) {
         terminal_putchar('-');
-
-    while (n) {
-        i += 1;
-        buf[BUF_SZ-i] = alphabet.data[n % alphabet.len];
-        n /= alphabet.len;
     }
-    while (i < padding) {
-        i += 1;
-        buf[BUF_SZ-i] = pad_char;
+
+    for (size_t i = magnitude.len; i < padding; i++) {
+        terminal_putchar(pad_char);
+        written += 1;
     }
 
-    terminal_write((struct str){.data = &buf[BUF_SZ-i], .len = i});
+    terminal_write(magnitude);
 
-    return i;
-}   
+    return written;
+}
 
 static int print_i32(struct printf_state* s, int padding, char pad_char)
 {
-    padding  = padding ? padding : 0;
+    char buf[FMT_BUF_MAX];
     pad_char = pad_char ? pad_char : ' ';
-    uint32_t n = va_arg(s->ap, int32_t);
-    return print_long(n, str_attach("0123456789"), true, padding, pad_char);
+    int32_t n = va_arg(s->ap, int32_t);
+    return print_digits(fmt_i32(buf, n), padding, pad_char);
 }
 
 static int print_u32(struct printf_state* s, int padding, char pad_char)
 {
-    padding  = padding ? padding : 0;
+    char buf[FMT_BUF_MAX];
     pad_char = pad_char ? pad_char : ' ';
     uint32_t n = va_arg(s->ap, uint32_t);
-    return print_long(n, str_attach("0123456789"), false, padding, pad_char);
+    return print_digits(fmt_u32(buf, n), padding, pad_char);
 }
 
 static int print_x32(struct printf_state* s, int padding, char pad_char)
 {
-    padding = padding ? padding : 0;
+    char buf[FMT_BUF_MAX];
     pad_char = pad_char ? pad_char : '0';
     uint32_t n = va_arg(s->ap, uint32_t);
-    struct str alphabet = str_attach("0123456789abcdef");
-    return print_long(n, alphabet, false, padding, pad_char);
+    return print_digits(fmt_x32(buf, n), padding, pad_char);
 }
 
 static int print_b32(struct printf_state* s, int padding, char pad_char)
 {
+    char buf[FMT_BUF_MAX];
     padding = padding ? padding : 32;
     pad_char = pad_char ? pad_char : '0';
     uint32_t n = va_arg(s->ap, uint32_t);
-    struct str alphabet = str_attach("01");
-    return print_long(n, alphabet, false, padding, pad_char);
+    return print_digits(fmt_b32(buf, n), padding, pad_char);
+}
+
+static int print_i64(struct printf_state* s, int padding, char pad_char)
+{
+    char buf[FMT_BUF_MAX];
+    pad_char = pad_char ? pad_char : ' ';
+    int64_t n = va_arg(s->ap, int64_t);
+    return print_digits(fmt_i64(buf, n), padding, pad_char);
+}
+
+static int print_u64(struct printf_state* s, int padding, char pad_char)
+{
+    char buf[FMT_BUF_MAX];
+    pad_char = pad_char ? pad_char : ' ';
+    uint64_t n = va_arg(s->ap, uint64_t);
+    return print_digits(fmt_u64(buf, n), padding, pad_char);
+}
+
+static int print_x64(struct printf_state* s, int padding, char pad_char)
+{
+    char buf[FMT_BUF_MAX];
+    pad_char = pad_char ? pad_char : '0';
+    uint64_t n = va_arg(s->ap, uint64_t);
+    return print_digits(fmt_x64(buf, n), padding, pad_char);
 }
 
 static int print_str(struct printf_state* s, int padding, char pad_char)
@@ -115,9 +119,7 @@ static int print_str(struct printf_state* s, int padding, char pad_char)
     (void)padding;
     (void)pad_char;
     const struct str str = va_arg(s->ap, struct str);
-    for (size_t i=0; i < str.len; i++) {
-        terminal_putchar(str.data[i]);
-    }
+    terminal_write(str);
     return str.len;
 }
 
@@ -130,7 +132,8 @@ static int print_char(struct printf_state* s)
         terminal_putchar(ch);
         return 1;
     } else {
-        return print_long(ch, str_attach("0123456789abcdef"), false, 0, 0);
+        char buf[FMT_BUF_MAX];
+        return print_digits(fmt_x32(buf, ch), 0, 0);
     }
 }
 
@@ -206,6 +209,15 @@ static int parse_format_cmd(struct printf_state* s)
         case 'x32':
             return print_x32(s, pad, pad_char);
 
+        case 'i64':
+            return print_i64(s, pad, pad_char);
+
+        case 'u64':
+            return print_u64(s, pad, pad_char);
+
+        case 'x64':
+            return print_x64(s, pad, pad_char);
+
         case 'str':
             return print_str(s, pad, pad_char);
 
@@ -242,12 +254,21 @@ int printf(struct str format, ...)
             s.written += ok;
             break;
 
-        default:
-            terminal_putchar(c);
-            s.written += 1;
+        default: {
+            /* the literal text up to the next command in one write, which
+             * is one record in asynchronous mode */
+            const size_t begin = s.i - 1;
+            while (ps_peek(&s) != EOF && ps_peek(&s) != '{') {
+                s.i++;
+            }
+            terminal_write(str_slice(s.str, begin, s.str.len - s.i));
+            s.written += s.i - begin;
             break;
         }
+        }
     }
 
+    /* output without a trailing newline (prompts, panics) shows up too */
+    terminal_flush();
     return s.written;
 }
@@ -0,0 +1,50 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "str.h"
+
+/*
+ * The kernel printf() with the terminal replaced by a byte counter, so only
+ * format parsing and number conversion is measured.
+ *
+ * libc.h can't be included next to <stdio.h>, the kernel printf() is
+ * declared under another name instead.
+ */
+int kernel_printf(struct str format, ...) __asm__("printf");
+
+static constexpr size_t OPS = 4096;
+
+static size_t terminal_bytes;
+
+void terminal_putchar(int c)
+{
+    (void)c;
+    terminal_bytes += 1;
+}
+
+void terminal_write(struct str s)
+{
+    terminal_bytes += s.len;
+}
+
+void terminal_flush(void)
+{
+}
+
+int main()
+{
+    const struct str plain = str_attach("a line of text without any format commands\n");
+    const struct str u32 = str_attach("{u32} {u32} {u32} {u32}\n");
+    const struct str x32 = str_attach("0x{x32} 0x{x32}\n");
+    const struct str u64 = str_attach("[{u64}] {i64}\n");
+    const struct str mixed = str_attach("pid {u32} fault at 0x{x32} ({str})\n");
+
+    BENCH("plain", i, OPS, kernel_printf(plain));
+    BENCH("u32x4", i, OPS, kernel_printf(u32, i, i * 7, i * 1000003, UINT32_MAX - i));
+    BENCH("x32x2", i, OPS, kernel_printf(x32, i, i * 0x9e3779b9));
+    BENCH("u64",   i, OPS, kernel_printf(u64, (uint64_t)i * 0x9e3779b97f4a7c15, -(int64_t)i * 1000000007));
+    BENCH("mixed", i, OPS, kernel_printf(mixed, i, i * 4096, str_attach("read")));
+
+    bench_sink = terminal_bytes;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,58 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "ring_buffer.h"
+
+/*
+ * Push/get pairs on a ring buffer with keypress sized and with larger
+ * entries, the byte-at-a-time copy makes the cost grow with the entry size.
+ */
+
+static constexpr size_t OPS = 4096;
+
+struct small { uint32_t a; };
+struct large { uint32_t a[8]; };
+
+static size_t push_get_small(struct ring_buffer* q, size_t i)
+{
+    struct small in = {.a = i};
+    struct small out;
+    ring_buffer_push(q, &in);
+    ring_buffer_get(q, &out);
+    return out.a;
+}
+
+static size_t push_get_large(struct ring_buffer* q, size_t i)
+{
+    struct large in = {.a = {i}};
+    struct large out;
+    ring_buffer_push(q, &in);
+    ring_buffer_get(q, &out);
+    return out.a[0];
+}
+
+/* pushes until full, then drains */
+static size_t fill_drain_small(struct ring_buffer* q)
+{
+    size_t acc = 0;
+    struct small e = {0};
+    while (ring_buffer_push(q, &e)) {
+        e.a += 1;
+    }
+    while (ring_buffer_get(q, &e)) {
+        acc += e.a;
+    }
+    return acc;
+}
+
+int main()
+{
+    struct ring_buffer small = make_ring_buffer(struct small);
+    struct ring_buffer large = make_ring_buffer(struct large);
+
+    BENCH("push_get/4",   i, OPS, push_get_small(&small, i));
+    BENCH("push_get/32",  i, OPS, push_get_large(&large, i));
+    BENCH("fill_drain/4", i, 64,  fill_drain_small(&small));
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,317 @@
+#include <limits.h>
+
+#include "str.h"
+
+/*
+ * Word-at-a-time (SWAR) helpers
+ * =============================
+ * A word is the native register size, 4 bytes on i686 and 8 on x86_64. The
+ * byte search loops handle two words per iteration.
+ *
+ * has_zero(v) sets the high bit of every zero byte in `v`. Bytes above the
+ * lowest zero byte can be false positives because of borrow propagation, so
+ * only the lowest set bit is exact. x86 is little endian, which makes the
+ * lowest set bit correspond to the first byte in memory.
+ */
+typedef size_t word_t;
+
+static constexpr word_t ONES  = (word_t)-1 / 0xFF;
+static constexpr word_t HIGHS = ONES * 0x80;
+
+static inline word_t load(const char* p)
+{
+    word_t w;
+    __builtin_memcpy(&w, p, sizeof w);
+    return w;
+}
+
+static inline word_t broadcast(char c)
+{
+    return ONES * (unsigned char)c;
+}
+
+static inline word_t has_zero(word_t v)
+{
+    return (v - ONES) & ~v & HIGHS;
+}
+
+/* index of the first byte flagged in a has_zero() mask */
+static inline size_t first_byte(word_t mask)
+{
+    return __builtin_ctzl(mask) / CHAR_BIT;
+}
+
+bool str_eq(struct str a, struct str b)
+{
+    if (a.len != b.len) {
+        return false;
+    }
+
+    size_t i = 0;
+    for (; i + sizeof(word_t) <= a.len; i += sizeof(word_t)) {
+        if (load(a.data + i) != load(b.data + i)) {
+            return false;
+        }
+    }
+    for (; i < a.len; i++) {
+        if (a.data[i] != b.data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+int str_cmp(struct str a, struct str b)
+{
+    const size_t len = a.len < b.len ? a.len : b.len;
+
+    size_t i = 0;
+    for (; i + sizeof(word_t) <= len; i += sizeof(word_t)) {
+        const word_t diff = load(a.data + i) ^ load(b.data + i);
+        if (diff) {
+            i += __builtin_ctzl(diff) / CHAR_BIT;
+            break;
+        }
+    }
+    for (; i < len; i++) {
+        const unsigned char ca = a.data[i];
+        const unsigned char cb = b.data[i];
+        if (ca != cb) {
+            return ca < cb ? -1 : 1;
+        }
+    }
+
+    if (a.len == b.len) {
+        return 0;
+    }
+    return a.len < b.len ? -1 : 1;
+}
+
+ptrdiff_t str_find_byte(struct str s, char c)
+{
+    const word_t pattern = broadcast(c);
+
+    size_t i = 0;
+    for (; i + 2 * sizeof(word_t) <= s.len; i += 2 * sizeof(word_t)) {
+        const word_t m0 = has_zero(load(s.data + i) ^ pattern);
+        const word_t m1 = has_zero(load(s.data + i + sizeof(word_t)) ^ pattern);
+        if (m0) {
+            return i + first_byte(m0);
+        }
+        if (m1) {
+            return i + sizeof(word_t) + first_byte(m1);
+        }
+    }
+    for (; i < s.len; i++) {
+        if (s.data[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static inline bool match_at(const char* p, struct str needle)
+{
+    return str_eq((struct str){.data = p, .len = needle.len}, needle);
+}
+
+/*
+ * Compares the first and the last byte of the needle against a word of
+ * candidate positions at once, and only verifies the positions where both
+ * match. See "SIMD-friendly algorithms for substring searching" by
+ * Wojciech Muła, this is the SWAR variant.
+ */
+ptrdiff_t str_find(struct str haystack, struct str needle)
+{
+    if (needle.len == 0) {
+        return 0;
+    }
+    if (needle.len > haystack.len) {
+        return -1;
+    }
+    if (needle.len == 1) {
+        return str_find_byte(haystack, needle.data[0]);
+    }
+
+    const size_t last = needle.len - 1;
+    const size_t end = haystack.len - last; /* one past the last start position */
+    const word_t first_pattern = broadcast(needle.data[0]);
+    const word_t last_pattern = broadcast(needle.data[last]);
+
+    size_t i = 0;
+    for (; i + sizeof(word_t) <= end; i += sizeof(word_t)) {
+        const word_t eq_first = load(haystack.data + i) ^ first_pattern;
+        const word_t eq_last = load(haystack.data + i + last) ^ last_pattern;
+        word_t mask = has_zero(eq_first | eq_last);
+
+        /* has_zero() can flag false positives above a real match, which
+         * the full comparison filters out */
+        while (mask) {
+            const size_t pos = i + first_byte(mask);
+            if (match_at(haystack.data + pos, needle)) {
+                return pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+    for (; i < end; i++) {
+        if (haystack.data[i] == needle.data[0]
+         && haystack.data[i + last] == needle.data[last]
+         && match_at(haystack.data + i, needle))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+struct str str_split_next(struct str_split* it)
+{
+    if (it->pos > it->s.len) {
+        return (struct str){0};
+    }
+
+    const struct str rest = str_slice(it->s, it->pos, 0);
+    const ptrdiff_t at = str_find_byte(rest, it->sep);
+    const size_t len = at == -1 ? rest.len : (size_t)at;
+
+    it->pos += len + 1;
+    return (struct str){.data = rest.data, .len = len};
+}
+
+/* Converts up to 4 ASCII digits at `p` into their value. The digits are
+ * validated and combined in parallel, returns -1 if any byte is not a
+ * digit. */
+static inline int32_t parse_4_digits(const char* p)
+{
+    uint32_t x;
+    __builtin_memcpy(&x, p, sizeof x);
+
+    /* every byte must be in 0x30..0x3F, and still be after adding 6 */
+    if ((x & 0xF0F0F0F0) != 0x30303030
+     || ((x + 0x06060606) & 0xF0F0F0F0) != 0x30303030)
+    {
+        return -1;
+    }
+
+    x -= 0x30303030;
+    x = (x * 10 + (x >> 8)) & 0x00FF00FF;   /* two 2-digit numbers */
+    x = (x * 100 + (x >> 16)) & 0x0000FFFF; /* one 4-digit number */
+    return x;
+}
+
+bool str_to_u32(struct str s, uint32_t* out)
+{
+    if (s.len == 0) {
+        return false;
+    }
+
+    /* at most 10 digits can be significant, a u64 accumulator can then
+     * not overflow */
+    size_t i = 0;
+    while (i + 1 < s.len && s.data[i] == '0') {
+        i++;
+    }
+    if (s.len - i > 10) {
+        return false;
+    }
+
+    uint64_t n = 0;
+    for (; i + 4 <= s.len; i += 4) {
+        const int32_t chunk = parse_4_digits(s.data + i);
+        if (chunk < 0) {
+            return false;
+        }
+        n = n * 10000 + chunk;
+    }
+    for (; i < s.len; i++) {
+        const unsigned d = (unsigned char)s.data[i] - '0';
+        if (d > 9) {
+            return false;
+        }
+        n = n * 10 + d;
+    }
+
+    if (n > UINT32_MAX) {
+        return false;
+    }
+    *out = n;
+    return true;
+}
+
+bool str_to_i32(struct str s, int32_t* out)
+{
+    const bool is_negative = s.len != 0 && s.data[0] == '-';
+    const bool has_sign = s.len != 0 && (s.data[0] == '-' || s.data[0] == '+');
+
+    uint32_t n;
+    if (!str_to_u32(str_slice(s, has_sign, 0), &n)) {
+        return false;
+    }
+
+    if (is_negative) {
+        if (n > (uint32_t)INT32_MAX + 1) {
+            return false;
+        }
+        *out = (int32_t)(0 - n);
+    } else {
+        if (n > INT32_MAX) {
+            return false;
+        }
+        *out = n;
+    }
+    return true;
+}
+
+/*
+ * MurmurHash3 (x86_32 variant) by Austin Appleby, public domain. Hashes four
+ * bytes per step and gives the same result on the host and on i686.
+ */
+static inline uint32_t rotl32(uint32_t x, int r)
+{
+    return (x << r) | (x >> (32 - r));
+}
+
+uint32_t str_hash(struct str s)
+{
+    constexpr uint32_t c1 = 0xcc9e2d51;
+    constexpr uint32_t c2 = 0x1b873593;
+
+    uint32_t h = 0x9747b28c;
+
+    size_t i = 0;
+    for (; i + 4 <= s.len; i += 4) {
+        uint32_t k;
+        __builtin_memcpy(&k, s.data + i, sizeof k);
+        k *= c1;
+        k = rotl32(k, 15);
+        k *= c2;
+        h ^= k;
+        h = rotl32(h, 13);
+        h = h * 5 + 0xe6546b64;
+    }
+
+    uint32_t k = 0;
+    switch (s.len & 3) {
+    case 3:
+        k ^= (uint8_t)s.data[i + 2] << 16;
+        [[fallthrough]];
+    case 2:
+        k ^= (uint8_t)s.data[i + 1] << 8;
+        [[fallthrough]];
+    case 1:
+        k ^= (uint8_t)s.data[i];
+        k *= c1;
+        k = rotl32(k, 15);
+        k *= c2;
+        h ^= k;
+    }
+
+    h ^= s.len;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+    return h;
+}
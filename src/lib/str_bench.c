@@ -0,0 +1,115 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "str.h"
+
+/*
+ * Compares the SWAR routines in str.c with byte-at-a-time loops on short
+ * (path component sized) and long (file sized) inputs.
+ */
+
+/* operations per timed round */
+static constexpr size_t LONG_OPS = 16;
+static constexpr size_t SHORT_OPS = 4096;
+
+__attribute__((noipa))
+static bool naive_eq(struct str a, struct str b)
+{
+    if (a.len != b.len) {
+        return false;
+    }
+    for (size_t i = 0; i < a.len; i++) {
+        if (a.data[i] != b.data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+__attribute__((noipa))
+static ptrdiff_t naive_find_byte(struct str s, char c)
+{
+    for (size_t i = 0; i < s.len; i++) {
+        if (s.data[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+__attribute__((noipa))
+static ptrdiff_t naive_find(struct str h, struct str n)
+{
+    for (size_t i = 0; i + n.len <= h.len; i++) {
+        size_t j = 0;
+        while (j < n.len && h.data[i + j] == n.data[j]) {
+            j++;
+        }
+        if (j == n.len) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+__attribute__((noipa))
+static uint32_t naive_to_u32(struct str s)
+{
+    uint32_t n = 0;
+    for (size_t i = 0; i < s.len; i++) {
+        n = n * 10 + (s.data[i] - '0');
+    }
+    return n;
+}
+
+__attribute__((noipa))
+static uint32_t fnv1a(struct str s)
+{
+    uint32_t h = 0x811c9dc5;
+    for (size_t i = 0; i < s.len; i++) {
+        h ^= (uint8_t)s.data[i];
+        h *= 0x01000193;
+    }
+    return h;
+}
+
+int main()
+{
+    constexpr size_t LONG = 64 * 1024;
+    char* long_a = malloc(LONG);
+    char* long_b = malloc(LONG);
+    for (size_t i = 0; i < LONG; i++) {
+        long_a[i] = long_b[i] = 'a' + i % 23;
+    }
+    long_a[LONG - 1] = long_b[LONG - 1] = '#';
+
+    const struct str la = {.data = long_a, .len = LONG};
+    const struct str lb = {.data = long_b, .len = LONG};
+    const struct str needle = {.data = long_a + LONG - 7, .len = 7};
+    const struct str short_a = str_attach("initrd.img");
+    const struct str short_b = str_attach("initrd.imh");
+    const struct str path = str_attach("usr/local/share/doc");
+    const struct str number = str_attach("4000000000");
+
+    BENCH("naive_eq/65536",        i, LONG_OPS,  naive_eq(la, lb));
+    BENCH("str_eq/65536",          i, LONG_OPS,  str_eq(la, lb));
+    BENCH("naive_find_byte/65536", i, LONG_OPS,  naive_find_byte(la, '#'));
+    BENCH("str_find_byte/65536",   i, LONG_OPS,  str_find_byte(la, '#'));
+    BENCH("naive_find/65536",      i, LONG_OPS,  naive_find(la, needle));
+    BENCH("str_find/65536",        i, LONG_OPS,  str_find(la, needle));
+    BENCH("fnv1a/65536",           i, LONG_OPS,  fnv1a(la));
+    BENCH("str_hash/65536",        i, LONG_OPS,  str_hash(la));
+
+    BENCH("naive_eq/short",        i, SHORT_OPS, naive_eq(short_a, short_b));
+    BENCH("str_eq/short",          i, SHORT_OPS, str_eq(short_a, short_b));
+    BENCH("naive_find_byte/short", i, SHORT_OPS, naive_find_byte(path, 'd'));
+    BENCH("str_find_byte/short",   i, SHORT_OPS, str_find_byte(path, 'd'));
+    BENCH("naive_to_u32",          i, SHORT_OPS, naive_to_u32(number));
+    BENCH("str_to_u32",            i, SHORT_OPS, ({ uint32_t n = 0; str_to_u32(number, &n); n; }));
+    BENCH("fnv1a/short",           i, SHORT_OPS, fnv1a(path));
+    BENCH("str_hash/short",        i, SHORT_OPS, str_hash(path));
+
+    free(long_a);
+    free(long_b);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,302 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <string.h>
+#include "str.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+/* Reference implementations */
+static ptrdiff_t naive_find_byte(const char* s, size_t len, char c)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static ptrdiff_t naive_find(const char* h, size_t hlen, const char* n, size_t nlen)
+{
+    if (nlen > hlen) {
+        return -1;
+    }
+    for (size_t i = 0; i + nlen <= hlen; i++) {
+        if (memcmp(h + i, n, nlen) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int sign(int n)
+{
+    return (n > 0) - (n < 0);
+}
+
+static int naive_cmp(const char* a, size_t alen, const char* b, size_t blen)
+{
+    const int r = memcmp(a, b, alen < blen ? alen : blen);
+    if (r != 0) {
+        return sign(r);
+    }
+    return alen == blen ? 0 : (alen < blen ? -1 : 1);
+}
+
+/* The strings under test are copied into exactly sized heap buffers, so the
+ * address sanitizer catches any read past the end */
+static struct str heap_str(const char* data, size_t len)
+{
+    char* p = malloc(len ? len : 1);
+    memcpy(p, data, len);
+    return (struct str){.data = p, .len = len};
+}
+
+static void random_fill(char* buf, size_t len, int alphabet)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = 'a' + rand() % alphabet;
+    }
+}
+
+int main()
+{
+    constexpr size_t random_rounds = 20000;
+    srand(1234);
+
+    test_begin("str_eq() and str_cmp()");
+    do {
+        bool ok = true;
+        for (size_t round = 0; ok && round < random_rounds; round++) {
+            char a[64], b[64];
+            const size_t alen = rand() % sizeof a;
+            const size_t blen = rand() % 4 == 0 ? alen : (size_t)rand() % sizeof b;
+            random_fill(a, alen, 3);
+            memcpy(b, a, alen < blen ? alen : blen);
+            if (blen > alen) {
+                random_fill(b + alen, blen - alen, 3);
+            }
+            if (rand() % 2 && blen) {
+                b[rand() % blen] = 'a' + rand() % 3;
+            }
+
+            struct str sa = heap_str(a, alen);
+            struct str sb = heap_str(b, blen);
+            const bool eq_expected = alen == blen && memcmp(a, b, alen) == 0;
+            const int cmp_expected = naive_cmp(a, alen, b, blen);
+
+            if (str_eq(sa, sb) != eq_expected) {
+                test_fail("str_eq(\"%.*s\", \"%.*s\") != %d", (int)alen, a, (int)blen, b, eq_expected);
+                ok = false;
+            } else if (str_cmp(sa, sb) != cmp_expected) {
+                test_fail("str_cmp(\"%.*s\", \"%.*s\") != %d", (int)alen, a, (int)blen, b, cmp_expected);
+                ok = false;
+            }
+            free((void*)sa.data);
+            free((void*)sb.data);
+        }
+        if (ok) {
+            test_ok("str_eq() and str_cmp() match memcmp()");
+        }
+    } while (0);
+
+    test_begin("str_cmp() compares bytes as unsigned");
+    do {
+        if (str_cmp(str_attach("\x80"), str_attach("\x01")) != 1) {
+            test_fail("0x80 should compare greater than 0x01");
+            break;
+        }
+        test_ok("bytes compare as unsigned");
+    } while (0);
+
+    test_begin("str_find_byte()");
+    do {
+        bool ok = true;
+        for (size_t round = 0; ok && round < random_rounds; round++) {
+            char buf[100];
+            const size_t len = rand() % sizeof buf;
+            random_fill(buf, len, 20);
+            const char c = 'a' + rand() % 26;
+
+            struct str s = heap_str(buf, len);
+            const ptrdiff_t expected = naive_find_byte(buf, len, c);
+            const ptrdiff_t got = str_find_byte(s, c);
+            if (got != expected) {
+                test_fail("str_find_byte(\"%.*s\", '%c') returned %td, expected %td",
+                          (int)len, buf, c, got, expected);
+                ok = false;
+            }
+            free((void*)s.data);
+        }
+        if (ok) {
+            test_ok("str_find_byte() matches a byte loop");
+        }
+    } while (0);
+
+    test_begin("str_find()");
+    do {
+        bool ok = true;
+        for (size_t round = 0; ok && round < random_rounds; round++) {
+            char hay[128], needle[12];
+            const size_t hlen = rand() % sizeof hay;
+            const size_t nlen = rand() % sizeof needle;
+            random_fill(hay, hlen, 2 + rand() % 3);
+            random_fill(needle, nlen, 2 + rand() % 3);
+
+            struct str h = heap_str(hay, hlen);
+            struct str n = heap_str(needle, nlen);
+            const ptrdiff_t expected = naive_find(hay, hlen, needle, nlen);
+            const ptrdiff_t got = str_find(h, n);
+            if (got != expected) {
+                test_fail("str_find(\"%.*s\", \"%.*s\") returned %td, expected %td",
+                          (int)hlen, hay, (int)nlen, needle, got, expected);
+                ok = false;
+            }
+            free((void*)h.data);
+            free((void*)n.data);
+        }
+        if (ok) {
+            test_ok("str_find() matches a naive search");
+        }
+    } while (0);
+
+    test_begin("str_split()");
+    do {
+        const char* expected[] = {"", "usr", "", "bin", "sh", ""};
+        struct str_split it = str_split(str_attach("/usr//bin/sh/"), '/');
+        size_t n = 0;
+        bool ok = true;
+        for (;;) {
+            const struct str token = str_split_next(&it);
+            if (token.data == NULL) {
+                break;
+            }
+            if (n >= sizeof expected / sizeof *expected
+             || token.len != strlen(expected[n])
+             || memcmp(token.data, expected[n], token.len) != 0)
+            {
+                test_fail("unexpected token #%zu \"%.*s\"", n, (int)token.len, token.data);
+                ok = false;
+                break;
+            }
+            n++;
+        }
+        if (ok && n != sizeof expected / sizeof *expected) {
+            test_fail("expected %zu tokens, got %zu", sizeof expected / sizeof *expected, n);
+            ok = false;
+        }
+        if (ok) {
+            test_ok("split \"/usr//bin/sh/\" into %zu tokens", n);
+        }
+    } while (0);
+
+    test_begin("str_to_u32() and str_to_i32()");
+    do {
+        struct {
+            const char* s;
+            bool        u_ok;
+            uint32_t    u;
+            bool        i_ok;
+            int32_t     i;
+        } cases[] = {
+            {"0",            true,  0,          true,  0},
+            {"7",            true,  7,          true,  7},
+            {"1234",         true,  1234,       true,  1234},
+            {"12345678",     true,  12345678,   true,  12345678},
+            {"000000000042", true,  42,         true,  42},
+            {"2147483647",   true,  2147483647, true,  2147483647},
+            {"2147483648",   true,  2147483648, false, 0},
+            {"4294967295",   true,  4294967295, false, 0},
+            {"4294967296",   false, 0,          false, 0},
+            {"99999999999",  false, 0,          false, 0},
+            {"-2147483648",  false, 0,          true,  INT32_MIN},
+            {"-2147483649",  false, 0,          false, 0},
+            {"+17",          false, 0,          true,  17},
+            {"",             false, 0,          false, 0},
+            {"-",            false, 0,          false, 0},
+            {"12a4",         false, 0,          false, 0},
+            {"123/",         false, 0,          false, 0},
+            {"1:23",         false, 0,          false, 0},
+        };
+        bool ok = true;
+        for (size_t c = 0; c < sizeof cases / sizeof *cases; c++) {
+            struct str s = heap_str(cases[c].s, strlen(cases[c].s));
+            uint32_t u = 0;
+            int32_t i = 0;
+            const bool u_ok = str_to_u32(s, &u);
+            const bool i_ok = str_to_i32(s, &i);
+            if (u_ok != cases[c].u_ok || (u_ok && u != cases[c].u)) {
+                test_fail("str_to_u32(\"%s\") returned %d/%u", cases[c].s, u_ok, u);
+                ok = false;
+            }
+            if (i_ok != cases[c].i_ok || (i_ok && i != cases[c].i)) {
+                test_fail("str_to_i32(\"%s\") returned %d/%d", cases[c].s, i_ok, i);
+                ok = false;
+            }
+            free((void*)s.data);
+        }
+        if (ok) {
+            test_ok("all %zu cases parsed correctly", sizeof cases / sizeof *cases);
+        }
+    } while (0);
+
+    test_begin("str_hash()");
+    do {
+        /* reference values of MurmurHash3_x86_32 with seed 0x9747b28c */
+        if (str_hash(str_attach("")) != 0xebb6c228
+         || str_hash(str_attach("a")) != 0x7fa09ea6
+         || str_hash(str_attach("abcd")) != 0xf0478627
+         || str_hash(str_attach("Hello, world!")) != 0x24884cba)
+        {
+            test_fail("str_hash() does not match MurmurHash3");
+            break;
+        }
+        test_ok("str_hash() matches MurmurHash3");
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}
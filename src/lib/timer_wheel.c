@@ -0,0 +1,123 @@
+#include "timer_wheel.h"
+
+static constexpr uint64_t SLOT_MASK = TIMER_WHEEL_SLOTS - 1;
+
+/* ticks covered by the whole wheel */
+static constexpr uint64_t SPAN = 1ULL << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS);
+
+static void wheel_link(struct timer_wheel* w, struct timer* t)
+{
+    uint64_t at = t->expires;
+    if (at - w->now >= SPAN) {
+        at = w->now + SPAN - 1;
+    }
+
+    /* the level where the distance fits into one revolution */
+    size_t level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1
+        && at - w->now >= 1ULL << (TIMER_WHEEL_BITS * (level + 1)))
+    {
+        level++;
+    }
+
+    struct timer** slot = &w->slots[level][(at >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+    t->next = *slot;
+    if (t->next != NULL) {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = slot;
+    *slot = t;
+}
+
+static void wheel_unlink(struct timer* t)
+{
+    *t->pprev = t->next;
+    if (t->next != NULL) {
+        t->next->pprev = t->pprev;
+    }
+    t->next = NULL;
+    t->pprev = NULL;
+}
+
+void timer_wheel_add(struct timer_wheel* w, struct timer* t, uint64_t expires,
+                     timer_fn_t fn, void* ctx)
+{
+    t->expires = expires > w->now ? expires : w->now + 1;
+    t->fn = fn;
+    t->ctx = ctx;
+    wheel_link(w, t);
+    w->pending += 1;
+}
+
+bool timer_wheel_cancel(struct timer_wheel* w, struct timer* t)
+{
+    if (!timer_pending(t)) {
+        return false;
+    }
+    wheel_unlink(t);
+    w->pending -= 1;
+    return true;
+}
+
+uint64_t timer_wheel_next(const struct timer_wheel* w)
+{
+    uint64_t next = UINT64_MAX;
+    for (size_t level = 0; level < TIMER_WHEEL_LEVELS && w->pending != 0; level++) {
+        /* the slot `now` is in was cascaded or run already, anything in it
+         * is a whole revolution ahead, so it comes last */
+        const uint64_t at = w->now >> (TIMER_WHEEL_BITS * level);
+        for (size_t k = 1; k <= TIMER_WHEEL_SLOTS; k++) {
+            const struct timer* t = w->slots[level][(at + k) & SLOT_MASK];
+            if (t == NULL) {
+                continue;
+            }
+            /* lower slots of this level are empty, so its earliest timer
+             * is in here */
+            for (; t != NULL; t = t->next) {
+                next = t->expires < next ? t->expires : next;
+            }
+            break;
+        }
+    }
+    return next;
+}
+
+/* moves the timers of the slot of level `level` that `now` just reached
+ * one level down, or further */
+static void cascade(struct timer_wheel* w, size_t level)
+{
+    struct timer** slot = &w->slots[level][(w->now >> (TIMER_WHEEL_BITS * level)) & SLOT_MASK];
+    struct timer* t = *slot;
+    *slot = NULL;
+    while (t != NULL) {
+        struct timer* next = t->next;
+        wheel_link(w, t);
+        t = next;
+    }
+}
+
+size_t timer_wheel_advance(struct timer_wheel* w, uint64_t now)
+{
+    size_t ran = 0;
+    while (w->now < now) {
+        w->now += 1;
+
+        /* a wrap of level n - 1 starts the next slot of level n */
+        for (size_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((w->now & ((1ULL << (TIMER_WHEEL_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            cascade(w, level);
+        }
+
+        struct timer** slot = &w->slots[0][w->now & SLOT_MASK];
+        while (*slot != NULL) {
+            struct timer* t = *slot;
+            wheel_unlink(t);
+            w->pending -= 1;
+            t->fn(t->ctx);
+            ran += 1;
+        }
+    }
+    return ran;
+}
@@ -0,0 +1,252 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include "timer_wheel.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+/* what a timer function records about its run */
+struct probe {
+    struct timer_wheel* w;
+    struct timer        t;
+    uint64_t            ran_at;
+    size_t              runs;
+    uint64_t            period; /* added again this many ticks later if non-zero */
+};
+
+static void probe_fn(void* ctx)
+{
+    struct probe* p = ctx;
+    p->ran_at = p->w->now;
+    p->runs += 1;
+    if (p->period != 0) {
+        timer_wheel_add(p->w, &p->t, p->w->now + p->period, probe_fn, p);
+    }
+}
+
+static uint32_t rng_state = 1;
+static uint32_t rng(void)
+{
+    /* xorshift32, deterministic across runs */
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+int main()
+{
+    test_begin("timers run exactly at their tick across level boundaries");
+    do {
+        static const uint64_t distances[] = {
+            1, 2, 63, 64, 65, 127, 128, 4095, 4096, 4097, 262143, 262144, 262145,
+            (1 << 24) - 1, 1 << 24, (1 << 24) + 70,
+        };
+        constexpr size_t count = sizeof distances / sizeof *distances;
+        struct timer_wheel w = TIMER_WHEEL_INIT;
+        struct probe probes[count] = {};
+
+        /* start off a round number so that slot indices wrap */
+        timer_wheel_advance(&w, 1000);
+        for (size_t i = 0; i < count; i++) {
+            probes[i].w = &w;
+            timer_wheel_add(&w, &probes[i].t, w.now + distances[i], probe_fn, &probes[i]);
+        }
+        timer_wheel_advance(&w, 1000 + (1 << 24) + 100);
+
+        size_t bad = count;
+        for (size_t i = 0; i < count; i++) {
+            if (probes[i].runs != 1 || probes[i].ran_at != 1000 + distances[i]) {
+                bad = i;
+                break;
+            }
+        }
+        if (bad != count) {
+            test_fail("timer %zu ticks out ran %zu times, last at +%llu", (size_t)distances[bad],
+                      probes[bad].runs, (unsigned long long)(probes[bad].ran_at - 1000));
+        } else if (w.pending != 0) {
+            test_fail("%zu timers still pending", w.pending);
+        } else {
+            test_ok("%zu distances", count);
+        }
+    } while (0);
+
+    test_begin("a timer in the past runs at the next tick");
+    do {
+        struct timer_wheel w = TIMER_WHEEL_INIT;
+        struct probe p = {.w = &w};
+        timer_wheel_advance(&w, 500);
+        timer_wheel_add(&w, &p.t, 10, probe_fn, &p);
+        if (timer_wheel_advance(&w, 500) != 0 || p.runs != 0) {
+            test_fail("ran without advancing");
+            break;
+        }
+        timer_wheel_advance(&w, 501);
+        if (p.runs != 1 || p.ran_at != 501) {
+            test_fail("ran %zu times at %llu", p.runs, (unsigned long long)p.ran_at);
+        } else {
+            test_ok("ran at 501");
+        }
+    } while (0);
+
+    test_begin("cancel");
+    do {
+        struct timer_wheel w = TIMER_WHEEL_INIT;
+        struct probe a = {.w = &w};
+        struct probe b = {.w = &w};
+        timer_wheel_add(&w, &a.t, 5000, probe_fn, &a);
+        timer_wheel_add(&w, &b.t, 5000, probe_fn, &b);
+        if (!timer_wheel_cancel(&w, &a.t) || timer_wheel_cancel(&w, &a.t) || timer_pending(&a.t)) {
+            test_fail("cancel of a pending timer should succeed once");
+            break;
+        }
+        timer_wheel_advance(&w, 6000);
+        if (a.runs != 0 || b.runs != 1 || timer_wheel_cancel(&w, &b.t)) {
+            test_fail("a ran %zu times, b %zu times", a.runs, b.runs);
+        } else {
+            test_ok("cancelled timer didn't run, its slot neighbour did");
+        }
+    } while (0);
+
+    test_begin("a timer function adds its timer again");
+    do {
+        struct timer_wheel w = TIMER_WHEEL_INIT;
+        struct probe p = {.w = &w, .period = 7};
+        timer_wheel_add(&w, &p.t, 7, probe_fn, &p);
+        timer_wheel_advance(&w, 7 * 1000);
+        if (p.runs != 1000 || p.ran_at != 7 * 1000 || w.pending != 1) {
+            test_fail("ran %zu times, last at %llu", p.runs, (unsigned long long)p.ran_at);
+        } else {
+            test_ok("ran every 7 ticks");
+        }
+    } while (0);
+
+    test_begin("next expiry");
+    do {
+        constexpr size_t count = 512;
+        struct timer_wheel w = TIMER_WHEEL_INIT;
+        struct probe* probes = calloc(count, sizeof *probes);
+        size_t errors = 0;
+
+        if (timer_wheel_next(&w) != UINT64_MAX) {
+            test_fail("an empty wheel has a next expiry");
+            free(probes);
+            break;
+        }
+        for (size_t round = 0; round < 2000; round++) {
+            const size_t i = rng() % count;
+            if (!timer_pending(&probes[i].t)) {
+                const uint64_t delay = rng() % 4 == 0 ? rng() % (1 << 20) : 1 + rng() % 100;
+                probes[i].w = &w;
+                timer_wheel_add(&w, &probes[i].t, w.now + delay, probe_fn, &probes[i]);
+            }
+            timer_wheel_advance(&w, w.now + rng() % 50);
+
+            uint64_t expected = UINT64_MAX;
+            for (size_t j = 0; j < count; j++) {
+                if (timer_pending(&probes[j].t) && probes[j].t.expires < expected) {
+                    expected = probes[j].t.expires;
+                }
+            }
+            errors += timer_wheel_next(&w) != expected;
+        }
+        if (errors != 0) {
+            test_fail("%zu wrong answers", errors);
+        } else {
+            test_ok("matches a scan of all timers");
+        }
+        free(probes);
+    } while (0);
+
+    test_begin("random adds and cancels");
+    do {
+        constexpr size_t count = 1024;
+        struct timer_wheel w = TIMER_WHEEL_INIT;
+        struct probe* probes = calloc(count, sizeof *probes);
+        uint64_t* due = calloc(count, sizeof *due);   /* 0: not pending */
+        size_t errors = 0;
+
+        for (uint64_t tick = 1; tick <= 100000; tick++) {
+            const size_t i = rng() % count;
+            if (due[i] == 0) {
+                /* mostly short timeouts, some far out */
+                const uint64_t delay = rng() % 8 == 0 ? rng() % 200000 : rng() % 300;
+                probes[i].w = &w;
+                probes[i].runs = 0;
+                due[i] = w.now + (delay > 0 ? delay : 1);
+                timer_wheel_add(&w, &probes[i].t, w.now + delay, probe_fn, &probes[i]);
+            } else if (rng() % 4 == 0) {
+                timer_wheel_cancel(&w, &probes[i].t);
+                due[i] = 0;
+            }
+
+            timer_wheel_advance(&w, tick);
+            for (size_t j = 0; j < count; j++) {
+                if (due[j] == tick) {
+                    errors += probes[j].runs != 1 || probes[j].ran_at != tick;
+                    due[j] = 0;
+                } else if (due[j] != 0) {
+                    errors += probes[j].runs != 0;
+                }
+            }
+        }
+
+        size_t pending = 0;
+        for (size_t j = 0; j < count; j++) {
+            pending += due[j] != 0;
+        }
+        if (errors != 0 || pending != w.pending) {
+            test_fail("%zu timers ran at the wrong tick, %zu pending, wheel says %zu",
+                      errors, pending, w.pending);
+        } else {
+            test_ok("%zu timers still pending", pending);
+        }
+        free(probes);
+        free(due);
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}
@@ -0,0 +1,349 @@
+#include "vma.h"
+
+/*
+ * Red-black tree
+ * ==============
+ * Textbook (CLRS) insert and erase with NULL leaves, which are black. The
+ * erase fixup tracks the parent separately since the replacing child may be
+ * NULL.
+ */
+static inline bool is_red(const struct vma* v)
+{
+    return v != NULL && v->red;
+}
+
+static struct vma* leftmost(struct vma* v)
+{
+    while (v->left != NULL) {
+        v = v->left;
+    }
+    return v;
+}
+
+static struct vma* rightmost(struct vma* v)
+{
+    while (v->right != NULL) {
+        v = v->right;
+    }
+    return v;
+}
+
+static void replace_child(struct vma_tree* t, struct vma* parent, struct vma* old, struct vma* new)
+{
+    if (parent == NULL) {
+        t->root = new;
+    } else if (parent->left == old) {
+        parent->left = new;
+    } else {
+        parent->right = new;
+    }
+}
+
+static void transplant(struct vma_tree* t, struct vma* old, struct vma* new)
+{
+    replace_child(t, old->parent, old, new);
+    if (new != NULL) {
+        new->parent = old->parent;
+    }
+}
+
+static void rotate_left(struct vma_tree* t, struct vma* x)
+{
+    struct vma* y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL) {
+        y->left->parent = x;
+    }
+    transplant(t, x, y);
+    y->left = x;
+    x->parent = y;
+}
+
+static void rotate_right(struct vma_tree* t, struct vma* x)
+{
+    struct vma* y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL) {
+        y->right->parent = x;
+    }
+    transplant(t, x, y);
+    y->right = x;
+    x->parent = y;
+}
+
+static void insert_fixup(struct vma_tree* t, struct vma* z)
+{
+    /* the parent is red so it isn't the root and the grandparent exists */
+    while (is_red(z->parent)) {
+        struct vma* p = z->parent;
+        struct vma* g = p->parent;
+
+        if (p == g->left) {
+            struct vma* uncle = g->right;
+            if (is_red(uncle)) {
+                p->red = false;
+                uncle->red = false;
+                g->red = true;
+                z = g;
+                continue;
+            }
+            if (z == p->right) {
+                rotate_left(t, p);
+                z = p;
+                p = z->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rotate_right(t, g);
+        } else {
+            struct vma* uncle = g->left;
+            if (is_red(uncle)) {
+                p->red = false;
+                uncle->red = false;
+                g->red = true;
+                z = g;
+                continue;
+            }
+            if (z == p->left) {
+                rotate_right(t, p);
+                z = p;
+                p = z->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rotate_left(t, g);
+        }
+    }
+    t->root->red = false;
+}
+
+static void erase_fixup(struct vma_tree* t, struct vma* x, struct vma* parent)
+{
+    while (x != t->root && !is_red(x)) {
+        if (x == parent->left) {
+            struct vma* w = parent->right;
+            if (is_red(w)) {
+                w->red = false;
+                parent->red = true;
+                rotate_left(t, parent);
+                w = parent->right;
+            }
+            if (!is_red(w->left) && !is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!is_red(w->right)) {
+                w->left->red = false;
+                w->red = true;
+                rotate_right(t, w);
+                w = parent->right;
+            }
+            w->red = parent->red;
+            parent->red = false;
+            w->right->red = false;
+            rotate_left(t, parent);
+        } else {
+            struct vma* w = parent->left;
+            if (is_red(w)) {
+                w->red = false;
+                parent->red = true;
+                rotate_right(t, parent);
+                w = parent->left;
+            }
+            if (!is_red(w->left) && !is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+                continue;
+            }
+            if (!is_red(w->left)) {
+                w->right->red = false;
+                w->red = true;
+                rotate_left(t, w);
+                w = parent->left;
+            }
+            w->red = parent->red;
+            parent->red = false;
+            w->left->red = false;
+            rotate_right(t, parent);
+        }
+        x = t->root;
+    }
+    if (x != NULL) {
+        x->red = false;
+    }
+}
+
+/*
+ * Regions
+ * =======
+ */
+struct vma* vma_find(struct vma_tree* t, uintptr_t addr)
+{
+    struct vma* v = t->last_hit;
+    if (v != NULL && addr >= v->start && addr < v->end) {
+        return v;
+    }
+
+    v = t->root;
+    while (v != NULL) {
+        if (addr < v->start) {
+            v = v->left;
+        } else if (addr >= v->end) {
+            v = v->right;
+        } else {
+            t->last_hit = v;
+            return v;
+        }
+    }
+    return NULL;
+}
+
+struct vma* vma_find_from(struct vma_tree* t, uintptr_t addr)
+{
+    struct vma* best = NULL;
+    struct vma* v = t->root;
+
+    while (v != NULL) {
+        if (addr < v->end) {
+            best = v;
+            if (addr >= v->start) {
+                break;
+            }
+            v = v->left;
+        } else {
+            v = v->right;
+        }
+    }
+    return best;
+}
+
+int vma_insert(struct vma_tree* t, struct vma* v)
+{
+    if (v->start >= v->end) {
+        return -1;
+    }
+
+    /* regions are disjoint, so the neighbours of the new one are all on the
+     * search path and checking every node on it catches any overlap */
+    struct vma* parent = NULL;
+    struct vma** link = &t->root;
+    while (*link != NULL) {
+        parent = *link;
+        if (v->end <= parent->start) {
+            link = &parent->left;
+        } else if (v->start >= parent->end) {
+            link = &parent->right;
+        } else {
+            return -1;
+        }
+    }
+
+    v->parent = parent;
+    v->left = NULL;
+    v->right = NULL;
+    v->red = true;
+    *link = v;
+    insert_fixup(t, v);
+
+    t->count += 1;
+    return 0;
+}
+
+void vma_remove(struct vma_tree* t, struct vma* z)
+{
+    struct vma* child;
+    struct vma* parent;
+    bool removed_red;
+
+    if (z->left == NULL || z->right == NULL) {
+        child = z->left != NULL ? z->left : z->right;
+        parent = z->parent;
+        removed_red = z->red;
+        transplant(t, z, child);
+    } else {
+        /* the successor takes z's place */
+        struct vma* y = leftmost(z->right);
+        removed_red = y->red;
+        child = y->right;
+        if (y->parent == z) {
+            parent = y;
+        } else {
+            parent = y->parent;
+            transplant(t, y, child);
+            y->right = z->right;
+            y->right->parent = y;
+        }
+        transplant(t, z, y);
+        y->left = z->left;
+        y->left->parent = y;
+        y->red = z->red;
+    }
+
+    if (!removed_red) {
+        erase_fixup(t, child, parent);
+    }
+
+    if (t->last_hit == z) {
+        t->last_hit = NULL;
+    }
+    t->count -= 1;
+}
+
+int vma_split(struct vma_tree* t, struct vma* v, uintptr_t addr, struct vma* tail)
+{
+    if (addr <= v->start || addr >= v->end) {
+        return -1;
+    }
+
+    tail->start = addr;
+    tail->end = v->end;
+    tail->flags = v->flags;
+    /* the order of v doesn't change, it only shrinks */
+    v->end = addr;
+
+    return vma_insert(t, tail);
+}
+
+struct vma* vma_merge_next(struct vma_tree* t, struct vma* v)
+{
+    struct vma* next = vma_next(v);
+    if (next == NULL || next->start != v->end || next->flags != v->flags) {
+        return NULL;
+    }
+
+    vma_remove(t, next);
+    v->end = next->end;
+    return next;
+}
+
+struct vma* vma_first(struct vma_tree* t)
+{
+    return t->root != NULL ? leftmost(t->root) : NULL;
+}
+
+struct vma* vma_next(struct vma* v)
+{
+    if (v->right != NULL) {
+        return leftmost(v->right);
+    }
+    while (v->parent != NULL && v == v->parent->right) {
+        v = v->parent;
+    }
+    return v->parent;
+}
+
+struct vma* vma_prev(struct vma* v)
+{
+    if (v->left != NULL) {
+        return rightmost(v->left);
+    }
+    while (v->parent != NULL && v == v->parent->left) {
+        v = v->parent;
+    }
+    return v->parent;
+}
@@ -0,0 +1,85 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "vma.h"
+
+/*
+ * Page fault style lookups in address spaces with a growing number of
+ * mappings: random addresses, runs of faults in the same region (which the
+ * last hit cache serves) and a linear scan over the sorted regions for
+ * comparison.
+ */
+
+static constexpr size_t LOOKUPS = 4096;
+static constexpr uintptr_t PAGE = 4096;
+
+__attribute__((noipa))
+static const struct vma* linear_find(const struct vma* regions, size_t count, uintptr_t addr)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (addr >= regions[i].start && addr < regions[i].end) {
+            return &regions[i];
+        }
+    }
+    return NULL;
+}
+
+static void bench_size(size_t count)
+{
+    struct vma* nodes = malloc(count * sizeof *nodes);
+    struct vma* sorted = malloc(count * sizeof *sorted);
+    uintptr_t* addrs = malloc(LOOKUPS * sizeof *addrs);
+    struct vma_tree t = VMA_TREE_INIT;
+    char name[64];
+
+    /* 1-4 page regions with 1 page gaps */
+    uintptr_t at = 0x400000;
+    for (size_t i = 0; i < count; i++) {
+        const uintptr_t pages = 1 + rand() % 4;
+        sorted[i] = (struct vma){.start = at, .end = at + pages * PAGE};
+        at += (pages + 1) * PAGE;
+    }
+
+    /* insert in random order, like a process mapping things over time */
+    for (size_t i = 0; i < count; i++) {
+        nodes[i] = sorted[i];
+    }
+    for (size_t i = count - 1; i > 0; i--) {
+        const size_t j = rand() % (i + 1);
+        const struct vma tmp = nodes[i];
+        nodes[i] = nodes[j];
+        nodes[j] = tmp;
+    }
+
+    for (size_t i = 0; i < LOOKUPS; i++) {
+        const struct vma* v = &sorted[rand() % count];
+        addrs[i] = v->start + rand() % (v->end - v->start);
+    }
+
+    snprintf(name, sizeof name, "insert/%zu", count);
+    BENCH_RESET(name, t = VMA_TREE_INIT, i, count, vma_insert(&t, &nodes[i]));
+
+    snprintf(name, sizeof name, "find/%zu", count);
+    BENCH(name, i, LOOKUPS, vma_find(&t, addrs[i]));
+
+    /* 16 faults per region */
+    snprintf(name, sizeof name, "find_runs/%zu", count);
+    BENCH(name, i, LOOKUPS, vma_find(&t, addrs[i / 16]));
+
+    snprintf(name, sizeof name, "linear_find/%zu", count);
+    BENCH(name, i, LOOKUPS / count + 8, linear_find(sorted, count, addrs[i]));
+
+    free(nodes);
+    free(sorted);
+    free(addrs);
+}
+
+int main()
+{
+    srand(1);
+    bench_size(100);
+    bench_size(1000);
+    bench_size(10000);
+    bench_size(100000);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,326 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <assert.h>
+#include "vma.h"
+
+static int g_status = EXIT_SUCCESS;
+static int test_no = 0;
+static bool test_ongoing = false;
+
+#define test_begin(name) _test_begin(name, __LINE__)
+static void _test_begin(const char* name, int line)
+{
+    (void)line; // unused for now
+    assert(!test_ongoing);
+    test_ongoing = true;
+    printf("\n#%i - %s:\n", test_no, name);
+    test_no += 1;
+}
+
+static void test_ok(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("OK: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    test_ongoing = false;
+}
+
+static void test_fail(const char* format, ...)
+{
+    va_list ap;
+    va_start(ap, format);
+    printf("FAIL: ");
+    vprintf(format, ap);
+    printf("\n");
+    va_end(ap);
+    g_status = EXIT_FAILURE;
+    test_ongoing = false;
+}
+
+/* Returns the black height of the subtree, -1 if an invariant is broken */
+static int check_subtree(const struct vma* v, const struct vma* parent, size_t* count)
+{
+    if (v == NULL) {
+        return 1;
+    }
+    if (v->parent != parent) {
+        return -1;
+    }
+    if (v->red && ((v->left && v->left->red) || (v->right && v->right->red))) {
+        return -1;
+    }
+    if ((v->left && v->left->end > v->start) || (v->right && v->right->start < v->end)) {
+        return -1;
+    }
+    const int l = check_subtree(v->left, v, count);
+    const int r = check_subtree(v->right, v, count);
+    if (l < 0 || r < 0 || l != r) {
+        return -1;
+    }
+    *count += 1;
+    return l + !v->red;
+}
+
+static bool check_tree(struct vma_tree* t)
+{
+    size_t count = 0;
+    if (t->root != NULL && t->root->red) {
+        return false;
+    }
+    if (check_subtree(t->root, NULL, &count) < 0 || count != t->count) {
+        return false;
+    }
+    /* iteration visits every region in order */
+    uintptr_t last_end = 0;
+    size_t visited = 0;
+    for (struct vma* v = vma_first(t); v != NULL; v = vma_next(v)) {
+        if (v->start < last_end || v->start >= v->end) {
+            return false;
+        }
+        if (vma_next(v) != NULL && vma_prev(vma_next(v)) != v) {
+            return false;
+        }
+        last_end = v->end;
+        visited += 1;
+    }
+    return visited == count;
+}
+
+int main()
+{
+    test_begin("basic insert, find and overlap");
+    do {
+        struct vma_tree t = VMA_TREE_INIT;
+        struct vma a = {.start = 0x1000, .end = 0x3000};
+        struct vma b = {.start = 0x3000, .end = 0x4000};
+        struct vma c = {.start = 0x2000, .end = 0x5000};
+        struct vma empty = {.start = 0x8000, .end = 0x8000};
+
+        if (vma_insert(&t, &a) != 0 || vma_insert(&t, &b) != 0) {
+            test_fail("adjacent regions should insert");
+            break;
+        }
+        if (vma_insert(&t, &c) != -1 || vma_insert(&t, &empty) != -1) {
+            test_fail("overlapping or empty region was inserted");
+            break;
+        }
+        if (vma_find(&t, 0x0fff) != NULL || vma_find(&t, 0x1000) != &a
+         || vma_find(&t, 0x2fff) != &a || vma_find(&t, 0x3000) != &b
+         || vma_find(&t, 0x4000) != NULL)
+        {
+            test_fail("lookup at region boundaries is wrong");
+            break;
+        }
+        if (vma_find_from(&t, 0) != &a || vma_find_from(&t, 0x3000) != &b
+         || vma_find_from(&t, 0x4000) != NULL)
+        {
+            test_fail("vma_find_from returned the wrong region");
+            break;
+        }
+        test_ok("boundaries are half open");
+    } while (0);
+
+    test_begin("split and merge");
+    do {
+        struct vma_tree t = VMA_TREE_INIT;
+        struct vma a = {.start = 0x1000, .end = 0x9000, .flags = 1};
+        struct vma tail;
+
+        vma_insert(&t, &a);
+        if (vma_split(&t, &a, 0x1000, &tail) != -1 || vma_split(&t, &a, 0x9000, &tail) != -1) {
+            test_fail("split at the region edge should fail");
+            break;
+        }
+        if (vma_split(&t, &a, 0x4000, &tail) != 0 || a.end != 0x4000
+         || tail.start != 0x4000 || tail.end != 0x9000 || vma_find(&t, 0x5000) != &tail)
+        {
+            test_fail("split produced the wrong regions");
+            break;
+        }
+        tail.flags = 2;
+        if (vma_merge_next(&t, &a) != NULL) {
+            test_fail("regions with different flags were merged");
+            break;
+        }
+        tail.flags = 1;
+        if (vma_merge_next(&t, &a) != &tail || a.end != 0x9000 || t.count != 1) {
+            test_fail("merge did not restore the original region");
+            break;
+        }
+        if (vma_find(&t, 0x5000) != &a) {
+            test_fail("last hit cache still points to the merged region");
+            break;
+        }
+        test_ok("split and merge are inverse");
+    } while (0);
+
+    test_begin("randomized against a page ownership array");
+    do {
+        constexpr size_t space = 8192; /* addresses are page numbers here */
+        constexpr size_t node_max = 2048;
+        constexpr size_t rounds = 200000;
+        static int owner[space + 1]; /* +1 so owner[v->end] is always valid */
+        static struct vma nodes[node_max];
+        static bool used[node_max];
+        struct vma_tree t = VMA_TREE_INIT;
+        bool ok = true;
+
+        for (size_t i = 0; i <= space; i++) {
+            owner[i] = -1;
+        }
+
+        srand(3);
+        for (size_t r = 0; ok && r < rounds; r++) {
+            const size_t n = rand() % node_max;
+            const uintptr_t addr = rand() % space;
+
+            switch (rand() % 5) {
+            case 0: { /* insert */
+                if (used[n]) {
+                    break;
+                }
+                const uintptr_t len = rand() % 32;
+                const uintptr_t end = addr + len > space ? space : addr + len;
+                bool free_range = len > 0;
+                for (uintptr_t a = addr; a < end; a++) {
+                    free_range &= owner[a] == -1;
+                }
+                nodes[n] = (struct vma){.start = addr, .end = end, .flags = rand() % 2};
+                const bool inserted = vma_insert(&t, &nodes[n]) == 0;
+                if (inserted != (free_range && end > addr)) {
+                    test_fail("insert of [%zu, %zu) disagrees with the reference", addr, end);
+                    ok = false;
+                    break;
+                }
+                if (inserted) {
+                    used[n] = true;
+                    for (uintptr_t a = addr; a < end; a++) {
+                        owner[a] = n;
+                    }
+                }
+                break;
+            }
+            case 1: { /* remove */
+                if (!used[n]) {
+                    break;
+                }
+                vma_remove(&t, &nodes[n]);
+                used[n] = false;
+                for (uintptr_t a = nodes[n].start; a < nodes[n].end; a++) {
+                    owner[a] = -1;
+                }
+                break;
+            }
+            case 2: { /* split */
+                if (!used[n]) {
+                    break;
+                }
+                size_t m = 0;
+                while (m < node_max && used[m]) {
+                    m++;
+                }
+                if (m == node_max) {
+                    break;
+                }
+                struct vma* v = &nodes[n];
+                const uintptr_t at = v->start + rand() % (v->end - v->start);
+                const int ret = vma_split(&t, v, at, &nodes[m]);
+                if ((ret == 0) != (at > v->start)) {
+                    test_fail("split of node %zu at %zu disagrees with the reference", n, at);
+                    ok = false;
+                    break;
+                }
+                if (ret == 0) {
+                    used[m] = true;
+                    for (uintptr_t a = nodes[m].start; a < nodes[m].end; a++) {
+                        owner[a] = m;
+                    }
+                }
+                break;
+            }
+            case 3: { /* merge */
+                if (!used[n]) {
+                    break;
+                }
+                struct vma* v = &nodes[n];
+                const int next = owner[v->end];
+                const bool expected = next != -1 && nodes[next].flags == v->flags;
+                struct vma* merged = vma_merge_next(&t, v);
+                if ((merged != NULL) != expected || (expected && merged != &nodes[next])) {
+                    test_fail("merge of node %zu disagrees with the reference", n);
+                    ok = false;
+                    break;
+                }
+                if (merged != NULL) {
+                    used[next] = false;
+                    for (uintptr_t a = v->start; a < v->end; a++) {
+                        owner[a] = n;
+                    }
+                }
+                break;
+            }
+            case 4: { /* find, twice to go through the last hit cache */
+                for (int i = 0; i < 2; i++) {
+                    struct vma* v = vma_find(&t, addr);
+                    if ((v == NULL && owner[addr] != -1)
+                     || (v != NULL && v != &nodes[owner[addr]]))
+                    {
+                        test_fail("find of %zu disagrees with the reference", addr);
+                        ok = false;
+                        break;
+                    }
+                }
+                break;
+            }
+            }
+
+            if (ok && r % 1024 == 0 && !check_tree(&t)) {
+                test_fail("red-black invariants broken after %zu operations", r);
+                ok = false;
+            }
+        }
+        if (ok && !check_tree(&t)) {
+            test_fail("red-black invariants broken at the end");
+            ok = false;
+        }
+        if (ok) {
+            test_ok("%zu random operations matched the reference, %zu regions left", rounds, t.count);
+        }
+    } while (0);
+
+    test_begin("sequential inserts stay balanced");
+    do {
+        constexpr size_t count = 1 << 16;
+        struct vma* nodes = malloc(count * sizeof *nodes);
+        struct vma_tree t = VMA_TREE_INIT;
+
+        for (size_t i = 0; i < count; i++) {
+            nodes[i] = (struct vma){.start = i * 2, .end = i * 2 + 1};
+            vma_insert(&t, &nodes[i]);
+        }
+        size_t depth = 0;
+        for (struct vma* v = t.root; v != NULL; v = v->right) {
+            depth += 1;
+        }
+        /* a red-black tree is at most 2 log2(n + 1) deep */
+        if (!check_tree(&t) || depth > 2 * 17) {
+            test_fail("right spine is %zu deep for %zu regions", depth, count);
+        } else {
+            test_ok("right spine is %zu deep for %zu regions", depth, count);
+        }
+        free(nodes);
+    } while (0);
+
+    if (g_status == EXIT_SUCCESS) {
+        printf("\nAll tests succeeded\n");
+    } else {
+        printf("\nOne or more tests failed\n");
+    }
+
+    return g_status;
+}